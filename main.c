@@ -1,10 +1,12 @@
 #include <ctype.h>
+#include <fcntl.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 #include <sys/mman.h>
+#include <sys/stat.h>
 
 typedef struct {
     const char * name;
@@ -25,13 +27,20 @@ static int my_sum(int a, int b, int c, int d) { return a + b + c + d; }
 static int my_func() {return 1;}
 
 enum {
-    SYMTABLE_SIZE = 100,  // symtable size in units
-    EXPR_SIZE = 1000,     // max expression size in chars
-    CODE_SIZE = 4096      // code segment size in bytes
+    SYMTABLE_SIZE = 100,      // symtable size in units
+    // Code size bound per expression char: a one-letter variable takes 16 bytes
+    // (movw, movt, ldr, push), so does a binary operator (pop, pop, op, push).
+    // Unary minus takes 12 (pop, rsb, push), a digit 8, calls less per char
+    CODE_BYTES_PER_CHAR = 16,
+    CODE_BASE_SIZE = 4096     // code size for an empty expression in bytes
 };
 
 static symbol_t symbols[SYMTABLE_SIZE+1];
-char expression_to_parse[EXPR_SIZE+1];
+// either a line read from stdin or a mapped file, zero terminated
+static char * expression_to_parse = NULL;
+static size_t expression_size = 0;
+static size_t expression_mapping_size = 0; // 0 if read from stdin
+static size_t code_size = 0;
 
 static size_t 
 init_symbols()
@@ -77,30 +86,43 @@ parse_variable(const char * token)
         fprintf(stderr, "Wrong token in input: %s\n", token);
         exit(1);
     }
-    char left[128], right[128];
-    memset(left, 0, sizeof(left));
-    memset(right, 0, sizeof(right));
-    strncpy(left, token, delim - token);
-    strncpy(right, delim+1, sizeof(right));
     symbol_t result;
-    result.name = calloc(1+strnlen(left,sizeof(left)), sizeof(char));
+    // token has no whitespaces, so the name is everything before '='
+    result.name = calloc(1+(delim-token), sizeof(char));
     result.pointer = calloc(1, sizeof(int));
-    sscanf(left, "%s", result.name); // eliminate whitespaces
-    sscanf(right, "%d", result.pointer); // parse int value
+    memcpy((char *) result.name, token, delim-token);
+    sscanf(delim+1, "%d", (int *) result.pointer); // parse int value
     return result;
 }
 
+// Removes whitespaces in place, returns the new length
+static size_t
+remove_spaces(char * line)
+{
+    size_t i = 0, j = 0;
+    for (i=0; '\0'!=line[i]; ++i) {
+        if (!isspace((unsigned char) line[i])) {
+            line[j] = line[i];
+            j++;
+        }
+    }
+    line[j] = '\0';
+    return j;
+}
+
+// Lines are read whole whatever their length is. With expression_from_file
+// expression lines of stdin are ignored
 static void
-read_input(size_t sym_start_offset)
+read_input(size_t sym_start_offset, int expression_from_file)
 {    
-    char buffer[128];
-    memset(buffer, 0, sizeof(buffer));    
+    char * buffer = NULL;
+    size_t buffer_size = 0;
     typedef enum {
         EXPRESSION, VARS
     } mode_t;
     mode_t current_mode = EXPRESSION;
     size_t current_index = sym_start_offset;
-    while (NULL!=fgets(buffer, sizeof(buffer), stdin)) {
+    while (-1!=getline(&buffer, &buffer_size, stdin)) {
         if ('#'==buffer[0]) continue;       
         else if ('.'==buffer[0]) {
             // change parsing mode
@@ -112,31 +134,71 @@ read_input(size_t sym_start_offset)
             }
         }
         else if (EXPRESSION==current_mode) {
-            memset(expression_to_parse, 0, sizeof(expression_to_parse));
-            size_t i=0, j = 0;
-            for (i=0; i<strnlen(buffer, sizeof(buffer)); ++i) {
-                if (!isspace(buffer[i])) {
-                    expression_to_parse[j] = buffer[i];
-                    j++;
-                }
-            }
+            if (expression_from_file) continue;
+            // the line becomes the expression without copying
+            free(expression_to_parse);
+            expression_to_parse = buffer;
+            expression_size = remove_spaces(buffer);
+            buffer = NULL;
+            buffer_size = 0;
         }
         else if (VARS==current_mode) {
-            char minibuf[256];
-            memset(minibuf, 0, sizeof(minibuf));
-            size_t offset = 0;
-            char * tokenizing_string = buffer;
-            while (sscanf(tokenizing_string, "%s", minibuf)>0) {
-                offset = strnlen(minibuf, sizeof(minibuf));
-                tokenizing_string += offset;
-                while (' '==tokenizing_string[0]) {
-                    tokenizing_string++;
+            char * token = strtok(buffer, " \t\r\n");
+            while (NULL!=token) {
+                if (current_index>=SYMTABLE_SIZE) {
+                    fprintf(stderr, "Too many variables\n");
+                    exit(1);
                 }
-                symbols[current_index++] = parse_variable(minibuf);
-                memset(minibuf, 0, sizeof(minibuf));
+                symbols[current_index++] = parse_variable(token);
+                token = strtok(NULL, " \t\r\n");
             }
         }
     }
+    free(buffer);
+}
+
+// Maps the whole file as the expression. Parser skips whitespaces itself,
+// so the text is used as is
+static void
+map_expression_file(const char * path)
+{
+    int fd = open(path, O_RDONLY);
+    struct stat file_stat;
+    if (-1==fd || -1==fstat(fd, &file_stat)) {
+        perror("Can't open expression file");
+        exit(1);
+    }
+    size_t page_size = sysconf(_SC_PAGESIZE);
+    expression_size = file_stat.st_size;
+    // zero page after the file contents terminates the string when the size
+    // is a multiple of the page size (otherwise the tail of the last page is zero)
+    expression_mapping_size = (expression_size / page_size + 1) * page_size;
+    char * mapping = mmap(0,
+                          expression_mapping_size,
+                          PROT_READ,
+                          MAP_PRIVATE|MAP_ANON,
+                          -1,
+                          0);
+    if (MAP_FAILED==mapping ||
+        (expression_size>0 &&
+         MAP_FAILED==mmap(mapping, expression_size, PROT_READ,
+                          MAP_PRIVATE|MAP_FIXED, fd, 0))) {
+        perror("Can't mmap expression file");
+        exit(2);
+    }
+    close(fd);
+    expression_to_parse = mapping;
+}
+
+static void
+free_expression()
+{
+    if (expression_mapping_size) {
+        munmap(expression_to_parse, expression_mapping_size);
+    }
+    else {
+        free(expression_to_parse);
+    }
 }
 
 static void
@@ -153,13 +215,14 @@ free_symbols(size_t offset)
 static void *
 init_program_code_buffer()
 {
+    code_size = CODE_BASE_SIZE + CODE_BYTES_PER_CHAR * expression_size;
     void * result = mmap(0,
-                         CODE_SIZE,
+                         code_size,
                          PROT_READ|PROT_WRITE|PROT_EXEC,
                          MAP_PRIVATE|MAP_ANON,
-                         0,
+                         -1,
                          0);
-    if (!result) {
+    if (MAP_FAILED==result) {
         perror("Can't mmap: ");
         exit(2);
     }
@@ -169,7 +232,7 @@ init_program_code_buffer()
 static void
 free_program_code_buffer(void * addr)
 {
-    munmap(addr, CODE_SIZE);
+    munmap(addr, code_size);
 }
 
 static void
@@ -183,12 +246,19 @@ call_function_and_print_result(void * addr)
     printf("%d\n", result);
 }
 
-void
-main()
+// Usage: JIT [expression_file] < input
+int
+main(int argc, char * argv[])
 {
     size_t functions_count = init_symbols();
     int res;
-    read_input(functions_count);
+    if (argc>1) {
+        map_expression_file(argv[1]);
+    }
+    read_input(functions_count, argc>1);
+    if (NULL==expression_to_parse) {
+        expression_to_parse = calloc(1, sizeof(char));
+    }
     void * code_buffer = init_program_code_buffer();
 
     res = jit_compile_expression_to_arm(expression_to_parse,
@@ -200,4 +270,6 @@ main()
     
     free_symbols(functions_count);
     free_program_code_buffer(code_buffer);
+    free_expression();
+    return 0;
 }
@@ -0,0 +1,285 @@
+#include <unordered_map>
+
+#include "optimizer/passes.h"
+
+namespace JIT {
+    namespace optimizer {
+        // Copies the function rewriting arithmetic on the way, so that results of
+        // rewrites are simplified again. Constants are kept as right operands of
+        // ADD and MUL and float up through chains to be merged. Equal operands are
+        // recognized by value ids, so the pass works best after CSE
+        class AlgebraicSimplification : public Pass {
+        public:
+            const char* Name() const override {
+                return "simplify";
+            }
+
+            void Run(Function& function) override {
+                std::vector<uint32_t> num_uses(function.Size(), 0);
+                for (const auto& instruction : function.instructions) {
+                    for (ValueId operand : instruction.operands) {
+                        ++num_uses[operand];
+                    }
+                }
+
+                result_ = Function();
+                is_shared_.clear();
+                constants_.clear();
+                std::vector<ValueId> images(function.Size());
+                for (ValueId value = 0; value < function.Size(); ++value) {
+                    const auto& instruction = function[value];
+                    if (instruction.opcode == Opcode::CONSTANT) {
+                        images[value] = Constant(instruction.constant);
+                    } else if (IsArithmetic(instruction.opcode)) {
+                        ValueId left = images[instruction.operands[0]];
+                        ValueId right = instruction.operands.size() > 1 ?
+                                        images[instruction.operands[1]] : left;
+                        images[value] = Simplify(instruction.opcode, left, right);
+                    } else {
+                        images[value] = Append(Remap(instruction, images));
+                    }
+                    // Rewriting through shared values would duplicate them
+                    if (num_uses[value] > 1) {
+                        is_shared_[images[value]] = true;
+                    }
+                }
+                result_.result = images[function.result];
+                function = std::move(result_);
+            }
+
+        private:
+            ValueId Simplify(Opcode opcode, ValueId left, ValueId right) {
+                switch (opcode) {
+                case Opcode::ADD:
+                    return Add(left, right);
+
+                case Opcode::SUB:
+                    return Sub(left, right);
+
+                case Opcode::MUL:
+                    return Mul(left, right);
+
+                default:
+                    return Negate(left);
+                }
+            }
+
+            ValueId Add(ValueId left, ValueId right) {
+                if (IsConstant(left) && IsConstant(right)) {
+                    return Constant(ConstantOf(left) + ConstantOf(right));
+                }
+                if (IsConstant(left)) {
+                    std::swap(left, right);
+                }
+                if (IsConstant(right)) {
+                    uint32_t constant = ConstantOf(right);
+                    if (constant == 0) {
+                        return left;
+                    }
+                    // (x + c1) + c2 = x + (c1 + c2)
+                    if (Is(left, Opcode::ADD) && IsConstant(Operand(left, 1))) {
+                        return Add(Operand(left, 0), Constant(ConstantOf(Operand(left, 1)) + constant));
+                    }
+                    // (c1 - x) + c2 = (c1 + c2) - x
+                    if (Is(left, Opcode::SUB) && IsConstant(Operand(left, 0))) {
+                        return Sub(Constant(ConstantOf(Operand(left, 0)) + constant), Operand(left, 1));
+                    }
+                    return Append(Opcode::ADD, left, right);
+                }
+                // x + -y = x - y
+                if (Is(right, Opcode::NEG)) {
+                    return Sub(left, Operand(right, 0));
+                }
+                if (Is(left, Opcode::NEG)) {
+                    return Sub(right, Operand(left, 0));
+                }
+                // (x + c) + y = (x + y) + c
+                if (IsOffset(left)) {
+                    return Add(Add(Operand(left, 0), right), Operand(left, 1));
+                }
+                if (IsOffset(right)) {
+                    return Add(Add(left, Operand(right, 0)), Operand(right, 1));
+                }
+                ValueId factored;
+                if (Factor(Opcode::ADD, left, right, factored)) {
+                    return factored;
+                }
+                return Append(Opcode::ADD, left, right);
+            }
+
+            ValueId Sub(ValueId left, ValueId right) {
+                if (IsConstant(left) && IsConstant(right)) {
+                    return Constant(ConstantOf(left) - ConstantOf(right));
+                }
+                if (left == right) {
+                    return Constant(0);
+                }
+                // x - c = x + (-c)
+                if (IsConstant(right)) {
+                    return Add(left, Constant(0u - ConstantOf(right)));
+                }
+                // x - -y = x + y
+                if (Is(right, Opcode::NEG)) {
+                    return Add(left, Operand(right, 0));
+                }
+                if (IsConstant(left)) {
+                    if (ConstantOf(left) == 0) {
+                        return Negate(right);
+                    }
+                    // c1 - (x + c2) = (c1 - c2) - x
+                    if (IsOffset(right)) {
+                        return Sub(Constant(ConstantOf(left) - ConstantOf(Operand(right, 1))),
+                                   Operand(right, 0));
+                    }
+                    return Append(Opcode::SUB, left, right);
+                }
+                // (x + c) - y = (x - y) + c
+                if (IsOffset(left)) {
+                    return Add(Sub(Operand(left, 0), right), Operand(left, 1));
+                }
+                // x - (y + c) = (x - y) + (-c)
+                if (IsOffset(right)) {
+                    return Add(Sub(left, Operand(right, 0)),
+                               Constant(0u - ConstantOf(Operand(right, 1))));
+                }
+                ValueId factored;
+                if (Factor(Opcode::SUB, left, right, factored)) {
+                    return factored;
+                }
+                return Append(Opcode::SUB, left, right);
+            }
+
+            ValueId Mul(ValueId left, ValueId right) {
+                if (IsConstant(left) && IsConstant(right)) {
+                    return Constant(ConstantOf(left) * ConstantOf(right));
+                }
+                if (IsConstant(left)) {
+                    std::swap(left, right);
+                }
+                if (IsConstant(right)) {
+                    uint32_t constant = ConstantOf(right);
+                    if (constant == 0) {
+                        // Calls computing x are kept by DCE
+                        return right;
+                    }
+                    if (constant == 1) {
+                        return left;
+                    }
+                    if (constant == 0xFFFFFFFF) {
+                        return Negate(left);
+                    }
+                    // (x * c1) * c2 = x * (c1 * c2)
+                    if (Is(left, Opcode::MUL) && IsConstant(Operand(left, 1))) {
+                        return Mul(Operand(left, 0), Constant(ConstantOf(Operand(left, 1)) * constant));
+                    }
+                    // -x * c = x * (-c)
+                    if (Is(left, Opcode::NEG)) {
+                        return Mul(Operand(left, 0), Constant(0u - constant));
+                    }
+                    return Append(Opcode::MUL, left, right);
+                }
+                if (Is(left, Opcode::NEG) && Is(right, Opcode::NEG)) {
+                    return Mul(Operand(left, 0), Operand(right, 0));
+                }
+                // (x * c) * y = (x * y) * c
+                if (IsScaled(left)) {
+                    return Mul(Mul(Operand(left, 0), right), Operand(left, 1));
+                }
+                if (IsScaled(right)) {
+                    return Mul(Mul(left, Operand(right, 0)), Operand(right, 1));
+                }
+                return Append(Opcode::MUL, left, right);
+            }
+
+            ValueId Negate(ValueId value) {
+                if (IsConstant(value)) {
+                    return Constant(0u - ConstantOf(value));
+                }
+                if (Is(value, Opcode::NEG)) {
+                    return Operand(value, 0);
+                }
+                // -(x - y) = y - x
+                if (Is(value, Opcode::SUB)) {
+                    return Sub(Operand(value, 1), Operand(value, 0));
+                }
+                // -(x * c) = x * (-c)
+                if (Is(value, Opcode::MUL) && IsConstant(Operand(value, 1))) {
+                    return Mul(Operand(value, 0), Constant(0u - ConstantOf(Operand(value, 1))));
+                }
+                return Append(Opcode::NEG, value, value);
+            }
+
+            // x * y + x * z = x * (y + z), same for subtraction
+            bool Factor(Opcode opcode, ValueId left, ValueId right, ValueId& result) {
+                if (!Is(left, Opcode::MUL) || !Is(right, Opcode::MUL) ||
+                    is_shared_[left] || is_shared_[right]) {
+                    return false;
+                }
+                for (uint32_t i = 0; i < 2; ++i) {
+                    for (uint32_t j = 0; j < 2; ++j) {
+                        if (Operand(left, i) == Operand(right, j)) {
+                            result = Mul(Operand(left, i),
+                                         Simplify(opcode, Operand(left, 1 - i), Operand(right, 1 - j)));
+                            return true;
+                        }
+                    }
+                }
+                return false;
+            }
+
+            bool Is(ValueId value, Opcode opcode) const {
+                return result_[value].opcode == opcode;
+            }
+
+            bool IsConstant(ValueId value) const {
+                return Is(value, Opcode::CONSTANT);
+            }
+
+            uint32_t ConstantOf(ValueId value) const {
+                return result_[value].constant;
+            }
+
+            ValueId Operand(ValueId value, uint32_t index) const {
+                return result_[value].operands[index];
+            }
+
+            // x + c used once
+            bool IsOffset(ValueId value) const {
+                return Is(value, Opcode::ADD) && IsConstant(Operand(value, 1)) && !is_shared_[value];
+            }
+
+            // x * c used once
+            bool IsScaled(ValueId value) const {
+                return Is(value, Opcode::MUL) && IsConstant(Operand(value, 1)) && !is_shared_[value];
+            }
+
+            ValueId Constant(uint32_t constant) {
+                auto it = constants_.find(constant);
+                if (it == constants_.end()) {
+                    it = constants_.emplace(constant, Append(MakeConstant(constant))).first;
+                }
+                return it->second;
+            }
+
+            ValueId Append(Opcode opcode, ValueId left, ValueId right) {
+                if (opcode == Opcode::NEG) {
+                    return Append(MakeOperation(opcode, {left}));
+                }
+                return Append(MakeOperation(opcode, {left, right}));
+            }
+
+            ValueId Append(Instruction instruction) {
+                is_shared_.push_back(false);
+                return result_.Append(std::move(instruction));
+            }
+
+            Function result_;
+            std::vector<bool> is_shared_;
+            std::unordered_map<uint32_t, ValueId> constants_;
+        };
+
+        std::unique_ptr<Pass> CreateAlgebraicSimplification() {
+            return std::make_unique<AlgebraicSimplification>();
+        }
+    } // namespace optimizer
+} // namespace JIT
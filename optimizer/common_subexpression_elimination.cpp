@@ -0,0 +1,87 @@
+#include <algorithm>
+#include <unordered_map>
+
+#include "optimizer/passes.h"
+
+namespace JIT {
+    namespace optimizer {
+        // Instructions with equal keys compute equal values. Impure calls have no keys
+        struct ValueKey {
+            Opcode opcode;
+            uint32_t constant;
+            void* symbol;
+            uint32_t epoch; // Loads and pure calls of different epochs may read different values
+            std::vector<ValueId> operands;
+
+            bool operator==(const ValueKey& other) const {
+                return opcode == other.opcode && constant == other.constant &&
+                       symbol == other.symbol && epoch == other.epoch && operands == other.operands;
+            }
+        };
+
+        struct ValueKeyHash {
+            size_t operator()(const ValueKey& key) const {
+                size_t hash = static_cast<size_t>(key.opcode);
+                for (size_t part : {static_cast<size_t>(key.constant), reinterpret_cast<size_t>(key.symbol),
+                                    static_cast<size_t>(key.epoch)}) {
+                    hash = hash * 31 + part;
+                }
+                for (ValueId operand : key.operands) {
+                    hash = hash * 31 + operand;
+                }
+                return hash;
+            }
+        };
+
+        class CommonSubexpressionElimination : public Pass {
+        public:
+            explicit CommonSubexpressionElimination(bool calls_modify_variables)
+                : calls_modify_variables_(calls_modify_variables) {
+            }
+
+            const char* Name() const override {
+                return "cse";
+            }
+
+            void Run(Function& function) override {
+                Function result;
+                std::vector<ValueId> images(function.Size());
+                std::unordered_map<ValueKey, ValueId, ValueKeyHash> numbers;
+                // Advances at calls that may change variables
+                uint32_t epoch = 0;
+                for (ValueId value = 0; value < function.Size(); ++value) {
+                    Instruction instruction = Remap(function[value], images);
+                    if (instruction.opcode == Opcode::CALL && !instruction.IsPureCall()) {
+                        images[value] = result.Append(std::move(instruction));
+                        epoch += calls_modify_variables_;
+                        continue;
+                    }
+
+                    bool reads_variables = instruction.opcode == Opcode::LOAD ||
+                                           (instruction.opcode == Opcode::CALL &&
+                                            instruction.info.purity == Purity::PURE);
+                    ValueKey key = {instruction.opcode, instruction.constant, instruction.symbol,
+                                    reads_variables ? epoch : 0, instruction.operands};
+                    if (instruction.opcode == Opcode::ADD || instruction.opcode == Opcode::MUL) {
+                        // Commutative
+                        std::sort(key.operands.begin(), key.operands.end());
+                    }
+                    auto it = numbers.find(key);
+                    if (it == numbers.end()) {
+                        it = numbers.emplace(std::move(key), result.Append(std::move(instruction))).first;
+                    }
+                    images[value] = it->second;
+                }
+                result.result = images[function.result];
+                function = std::move(result);
+            }
+
+        private:
+            bool calls_modify_variables_;
+        };
+
+        std::unique_ptr<Pass> CreateCommonSubexpressionElimination(bool calls_modify_variables) {
+            return std::make_unique<CommonSubexpressionElimination>(calls_modify_variables);
+        }
+    } // namespace optimizer
+} // namespace JIT
@@ -0,0 +1,49 @@
+#include "optimizer/passes.h"
+
+namespace JIT {
+    namespace optimizer {
+        class ConstantFolding : public Pass {
+        public:
+            const char* Name() const override {
+                return "fold";
+            }
+
+            void Run(Function& function) override {
+                // Operands precede users, so folded operands are seen first
+                for (auto& instruction : function.instructions) {
+                    bool is_const_call = instruction.opcode == Opcode::CALL &&
+                                         instruction.info.purity == Purity::CONST &&
+                                         instruction.operands.size() <= MAX_EVALUATED_ARGUMENTS;
+                    if (!IsArithmetic(instruction.opcode) && !is_const_call) {
+                        continue;
+                    }
+                    bool is_constant = true;
+                    for (ValueId operand : instruction.operands) {
+                        is_constant = is_constant && function[operand].opcode == Opcode::CONSTANT;
+                    }
+                    if (!is_constant) {
+                        continue;
+                    }
+                    if (is_const_call) {
+                        // Evaluated once instead of every time
+                        std::vector<uint32_t> arguments;
+                        for (ValueId operand : instruction.operands) {
+                            arguments.push_back(function[operand].constant);
+                        }
+                        instruction = MakeConstant(CallExtern(instruction.symbol, arguments));
+                        continue;
+                    }
+                    uint32_t left = function[instruction.operands[0]].constant;
+                    uint32_t right = instruction.operands.size() > 1 ?
+                                     function[instruction.operands[1]].constant : 0;
+                    // Operands become dead and are left to DCE
+                    instruction = MakeConstant(Evaluate(instruction.opcode, left, right));
+                }
+            }
+        };
+
+        std::unique_ptr<Pass> CreateConstantFolding() {
+            return std::make_unique<ConstantFolding>();
+        }
+    } // namespace optimizer
+} // namespace JIT
@@ -0,0 +1,44 @@
+#include "optimizer/passes.h"
+
+namespace JIT {
+    namespace optimizer {
+        class DeadCodeElimination : public Pass {
+        public:
+            const char* Name() const override {
+                return "dce";
+            }
+
+            void Run(Function& function) override {
+                std::vector<bool> is_live(function.Size(), false);
+                is_live[function.result] = true;
+                // Users follow their operands
+                for (ValueId value = function.Size(); value > 0; --value) {
+                    const auto& instruction = function[value - 1];
+                    if (instruction.opcode == Opcode::CALL && !instruction.IsPureCall()) {
+                        // Externs may have side effects
+                        is_live[value - 1] = true;
+                    }
+                    if (is_live[value - 1]) {
+                        for (ValueId operand : instruction.operands) {
+                            is_live[operand] = true;
+                        }
+                    }
+                }
+
+                Function result;
+                std::vector<ValueId> images(function.Size());
+                for (ValueId value = 0; value < function.Size(); ++value) {
+                    if (is_live[value]) {
+                        images[value] = result.Append(Remap(function[value], images));
+                    }
+                }
+                result.result = images[function.result];
+                function = std::move(result);
+            }
+        };
+
+        std::unique_ptr<Pass> CreateDeadCodeElimination() {
+            return std::make_unique<DeadCodeElimination>();
+        }
+    } // namespace optimizer
+} // namespace JIT
@@ -0,0 +1,495 @@
+#include <algorithm>
+#include <limits>
+#include <unordered_map>
+
+#include "optimizer/passes.h"
+
+namespace JIT {
+    namespace optimizer {
+        // Rounds of rewriting, unless the graph saturates or reaches the budget earlier
+        constexpr uint32_t MAX_ITERATIONS = 16;
+
+        // Approximate cycles of the ARM instructions, with MULTIPLY_COST of the code
+        // generator. Operands which are constants mostly become immediates
+        constexpr uint64_t CONSTANT_COST = 0;
+        constexpr uint64_t LOAD_COST = 1;
+        constexpr uint64_t DATA_COST = 1;
+        constexpr uint64_t SHIFT_COST = 1;
+        constexpr uint64_t DEFAULT_CALL_COST = 10;
+        constexpr uint64_t INFINITE_COST = std::numeric_limits<uint64_t>::max();
+
+        using ClassId = uint32_t;
+        using NodeId = uint32_t;
+
+        // Operation over classes of equal values
+        struct ENode {
+            Opcode opcode;
+            uint32_t constant;
+            void* symbol;
+            std::vector<ClassId> children;
+            ValueId origin; // Instruction of LOAD and CALL, not a part of the key
+
+            bool operator==(const ENode& other) const {
+                return opcode == other.opcode && constant == other.constant &&
+                       symbol == other.symbol && children == other.children;
+            }
+        };
+
+        struct ENodeHash {
+            size_t operator()(const ENode& node) const {
+                size_t hash = static_cast<size_t>(node.opcode);
+                for (size_t part : {static_cast<size_t>(node.constant), reinterpret_cast<size_t>(node.symbol)}) {
+                    hash = hash * 31 + part;
+                }
+                for (ClassId child : node.children) {
+                    hash = hash * 31 + child;
+                }
+                return hash;
+            }
+        };
+
+        // Classes are merged by union-find. Congruence (equal nodes over equal classes
+        // are in one class) is restored by Rebuild, which also folds constants
+        class EGraph {
+        public:
+            uint32_t NumNodes() const {
+                return nodes_.size();
+            }
+
+            const ENode& Node(NodeId node) const {
+                return nodes_[node];
+            }
+
+            ClassId ClassOf(NodeId node) {
+                return Find(classes_[node]);
+            }
+
+            // Whether the node is not a duplicate of an equal one, as of the last rebuild
+            bool IsCanonical(NodeId node) const {
+                return node < is_canonical_.size() && is_canonical_[node];
+            }
+
+            // Nodes of the class as of the last rebuild
+            const std::vector<NodeId>& Nodes(ClassId cls) const {
+                static const std::vector<NodeId> none;
+                return cls < class_nodes_.size() ? class_nodes_[cls] : none;
+            }
+
+            bool IsConstant(ClassId cls, uint32_t& constant) {
+                cls = Find(cls);
+                constant = constants_[cls];
+                return is_constant_[cls];
+            }
+
+            bool IsConstantEqual(ClassId cls, uint32_t constant) {
+                uint32_t value;
+                return IsConstant(cls, value) && value == constant;
+            }
+
+            ClassId Find(ClassId cls) {
+                while (parents_[cls] != cls) {
+                    cls = parents_[cls] = parents_[parents_[cls]];
+                }
+                return cls;
+            }
+
+            ClassId Add(ENode node) {
+                for (ClassId& child : node.children) {
+                    child = Find(child);
+                }
+                auto it = table_.find(node);
+                if (it != table_.end()) {
+                    return ClassOf(it->second);
+                }
+                NodeId id = nodes_.size();
+                nodes_.push_back(node);
+                classes_.push_back(id);
+                parents_.push_back(id);
+                is_constant_.push_back(node.opcode == Opcode::CONSTANT);
+                constants_.push_back(node.constant);
+                table_.emplace(std::move(node), id);
+                Fold(id);
+                return Find(id);
+            }
+
+            ClassId Add(Opcode opcode, std::vector<ClassId> children) {
+                return Add({opcode, 0, nullptr, std::move(children), 0});
+            }
+
+            ClassId AddConstant(uint32_t constant) {
+                return Add({Opcode::CONSTANT, constant, nullptr, {}, 0});
+            }
+
+            bool Union(ClassId left, ClassId right) {
+                left = Find(left);
+                right = Find(right);
+                if (left == right) {
+                    return false;
+                }
+                parents_[right] = left;
+                if (is_constant_[right]) {
+                    is_constant_[left] = true;
+                    constants_[left] = constants_[right];
+                }
+                return true;
+            }
+
+            void Rebuild() {
+                bool is_changed = true;
+                while (is_changed) {
+                    is_changed = false;
+                    table_.clear();
+                    for (NodeId id = 0; id < nodes_.size(); ++id) {
+                        for (ClassId& child : nodes_[id].children) {
+                            child = Find(child);
+                        }
+                        auto [it, is_inserted] = table_.emplace(nodes_[id], id);
+                        if (!is_inserted) {
+                            is_changed |= Union(classes_[it->second], classes_[id]);
+                        }
+                    }
+                    for (NodeId id = 0, num_nodes = nodes_.size(); id < num_nodes; ++id) {
+                        is_changed |= Fold(id);
+                    }
+                }
+
+                class_nodes_.assign(nodes_.size(), {});
+                is_canonical_.assign(nodes_.size(), false);
+                for (NodeId id = 0; id < nodes_.size(); ++id) {
+                    if (table_[nodes_[id]] == id) {
+                        class_nodes_[ClassOf(id)].push_back(id);
+                        is_canonical_[id] = true;
+                    }
+                }
+            }
+
+        private:
+            // Merges arithmetic over constants with the constant
+            bool Fold(NodeId id) {
+                const ENode& node = nodes_[id];
+                if (!IsArithmetic(node.opcode)) {
+                    return false;
+                }
+                uint32_t left, right = 0;
+                if (!IsConstant(node.children[0], left) ||
+                    (node.children.size() > 1 && !IsConstant(node.children[1], right))) {
+                    return false;
+                }
+                Opcode opcode = node.opcode;
+                return Union(classes_[id], AddConstant(Evaluate(opcode, left, right)));
+            }
+
+            std::vector<ENode> nodes_;
+            std::vector<ClassId> classes_; // Class of every node, maybe not the root one
+            std::vector<ClassId> parents_;
+            std::vector<bool> is_constant_;
+            std::vector<uint32_t> constants_;
+            std::vector<std::vector<NodeId>> class_nodes_;
+            std::vector<bool> is_canonical_;
+            std::unordered_map<ENode, NodeId, ENodeHash> table_;
+        };
+
+        // Builds the e-graph of all forms of the function reachable by integer
+        // identities and extracts the cheapest one. Reordering calls would change
+        // their side effects, so functions with impure calls are left as they are
+        class EqualitySaturation : public Pass {
+        public:
+            explicit EqualitySaturation(uint32_t budget)
+                : budget_(budget) {
+            }
+
+            const char* Name() const override {
+                return "saturate";
+            }
+
+            void Run(Function& function) override {
+                if (function.Size() > budget_) {
+                    return;
+                }
+                for (const auto& instruction : function.instructions) {
+                    if (instruction.opcode == Opcode::CALL && !instruction.IsPureCall()) {
+                        return;
+                    }
+                }
+
+                graph_ = EGraph();
+                std::vector<ClassId> classes(function.Size());
+                for (ValueId value = 0; value < function.Size(); ++value) {
+                    const auto& instruction = function[value];
+                    ENode node = {instruction.opcode, instruction.constant, instruction.symbol, {}, value};
+                    for (ValueId operand : instruction.operands) {
+                        node.children.push_back(classes[operand]);
+                    }
+                    classes[value] = graph_.Add(std::move(node));
+                }
+
+                for (uint32_t i = 0; i < MAX_ITERATIONS && graph_.NumNodes() < budget_; ++i) {
+                    graph_.Rebuild();
+                    uint32_t num_nodes = graph_.NumNodes();
+                    if (!ApplyRules() && graph_.NumNodes() == num_nodes) {
+                        break;
+                    }
+                }
+                graph_.Rebuild();
+
+                Extract(function);
+                Function result;
+                result.result = Emit(function, graph_.Find(classes[function.result]), result);
+                function = std::move(result);
+            }
+
+        private:
+            // Returns whether any classes were merged
+            bool ApplyRules() {
+                is_changed_ = false;
+                for (NodeId id = 0, num_nodes = graph_.NumNodes(); id < num_nodes && graph_.NumNodes() < budget_; ++id) {
+                    if (!graph_.IsCanonical(id)) {
+                        continue;
+                    }
+                    ENode node = graph_.Node(id);
+                    ClassId cls = graph_.ClassOf(id);
+                    for (ClassId& child : node.children) {
+                        child = graph_.Find(child);
+                    }
+                    switch (node.opcode) {
+                    case Opcode::ADD:
+                        RewriteAdd(cls, node.children[0], node.children[1]);
+                        break;
+
+                    case Opcode::SUB:
+                        RewriteSub(cls, node.children[0], node.children[1]);
+                        break;
+
+                    case Opcode::MUL:
+                        RewriteMul(cls, node.children[0], node.children[1]);
+                        break;
+
+                    case Opcode::NEG:
+                        RewriteNeg(cls, node.children[0]);
+                        break;
+
+                    default:
+                        break;
+                    }
+                }
+                return is_changed_;
+            }
+
+            void RewriteAdd(ClassId cls, ClassId left, ClassId right) {
+                Merge(cls, graph_.Add(Opcode::ADD, {right, left}));
+                if (graph_.IsConstantEqual(right, 0)) {
+                    Merge(cls, left);
+                }
+                // x + x = x * 2
+                if (left == right) {
+                    Merge(cls, graph_.Add(Opcode::MUL, {left, graph_.AddConstant(2)}));
+                }
+                ForEach(left, Opcode::ADD, [&](const ENode& node) {
+                    // (x + y) + z = x + (y + z)
+                    Merge(cls, graph_.Add(Opcode::ADD, {node.children[0],
+                                                        graph_.Add(Opcode::ADD, {node.children[1], right})}));
+                });
+                ForEach(right, Opcode::NEG, [&](const ENode& node) {
+                    // x + -y = x - y
+                    Merge(cls, graph_.Add(Opcode::SUB, {left, node.children[0]}));
+                });
+                ForEach(left, Opcode::MUL, [&](const ENode& product) {
+                    ClassId factor = graph_.Find(product.children[0]);
+                    // x * y + x = x * (y + 1)
+                    if (factor == right) {
+                        Merge(cls, graph_.Add(Opcode::MUL, {factor, graph_.Add(Opcode::ADD, {product.children[1],
+                                                                                             graph_.AddConstant(1)})}));
+                    }
+                    // x * y + x * z = x * (y + z)
+                    ForEach(right, Opcode::MUL, [&](const ENode& other) {
+                        if (graph_.Find(other.children[0]) == factor) {
+                            Merge(cls, graph_.Add(Opcode::MUL, {factor, graph_.Add(Opcode::ADD, {product.children[1],
+                                                                                                 other.children[1]})}));
+                        }
+                    });
+                });
+            }
+
+            void RewriteSub(ClassId cls, ClassId left, ClassId right) {
+                if (left == right) {
+                    Merge(cls, graph_.AddConstant(0));
+                }
+                // x - y = x + -y
+                Merge(cls, graph_.Add(Opcode::ADD, {left, graph_.Add(Opcode::NEG, {right})}));
+            }
+
+            void RewriteMul(ClassId cls, ClassId left, ClassId right) {
+                Merge(cls, graph_.Add(Opcode::MUL, {right, left}));
+                ForEach(left, Opcode::MUL, [&](const ENode& node) {
+                    // (x * y) * z = x * (y * z)
+                    Merge(cls, graph_.Add(Opcode::MUL, {node.children[0],
+                                                        graph_.Add(Opcode::MUL, {node.children[1], right})}));
+                });
+                ForEach(right, Opcode::NEG, [&](const ENode& node) {
+                    // x * -y = -(x * y)
+                    Merge(cls, graph_.Add(Opcode::NEG, {graph_.Add(Opcode::MUL, {left, node.children[0]})}));
+                });
+
+                uint32_t constant;
+                if (!graph_.IsConstant(right, constant)) {
+                    return;
+                }
+                if (constant == 0 || constant == 1) {
+                    Merge(cls, constant == 0 ? right : left);
+                    return;
+                }
+                // Shifts and additions: x * (2^k + 1) = x * 2^k + x, x * (2^k - 1) = x * 2^k - x,
+                // x * (c * 2^k) = (x * c) * 2^k
+                if (IsPowerOfTwo(constant - 1) && constant > 2) {
+                    Merge(cls, graph_.Add(Opcode::ADD, {graph_.Add(Opcode::MUL, {left, graph_.AddConstant(constant - 1)}),
+                                                        left}));
+                } else if (IsPowerOfTwo(constant + 1) && constant > 2) {
+                    Merge(cls, graph_.Add(Opcode::SUB, {graph_.Add(Opcode::MUL, {left, graph_.AddConstant(constant + 1)}),
+                                                        left}));
+                } else if (constant % 2 == 0 && !IsPowerOfTwo(constant)) {
+                    uint32_t power = constant & (0u - constant);
+                    Merge(cls, graph_.Add(Opcode::MUL, {graph_.Add(Opcode::MUL, {left, graph_.AddConstant(constant / power)}),
+                                                        graph_.AddConstant(power)}));
+                }
+                ForEach(left, Opcode::ADD, [&](const ENode& node) {
+                    // (x + y) * c = x * c + y * c
+                    Merge(cls, graph_.Add(Opcode::ADD, {graph_.Add(Opcode::MUL, {node.children[0], right}),
+                                                        graph_.Add(Opcode::MUL, {node.children[1], right})}));
+                });
+            }
+
+            void RewriteNeg(ClassId cls, ClassId value) {
+                ForEach(value, Opcode::NEG, [&](const ENode& node) {
+                    Merge(cls, node.children[0]);
+                });
+                ForEach(value, Opcode::SUB, [&](const ENode& node) {
+                    // -(x - y) = y - x
+                    Merge(cls, graph_.Add(Opcode::SUB, {node.children[1], node.children[0]}));
+                });
+                ForEach(value, Opcode::MUL, [&](const ENode& node) {
+                    // -(x * y) = x * -y
+                    Merge(cls, graph_.Add(Opcode::MUL, {node.children[0],
+                                                        graph_.Add(Opcode::NEG, {node.children[1]})}));
+                });
+            }
+
+            template <class Callback>
+            void ForEach(ClassId cls, Opcode opcode, Callback callback) {
+                const auto& nodes = graph_.Nodes(graph_.Find(cls));
+                for (uint32_t i = 0; i < nodes.size() && graph_.NumNodes() < budget_; ++i) {
+                    // Copy: adding nodes may move them
+                    ENode node = graph_.Node(nodes[i]);
+                    if (node.opcode == opcode) {
+                        callback(node);
+                    }
+                }
+            }
+
+            void Merge(ClassId cls, ClassId other) {
+                is_changed_ |= graph_.Union(cls, other);
+            }
+
+            uint64_t Cost(const Function& function, const ENode& node) {
+                switch (node.opcode) {
+                case Opcode::CONSTANT:
+                    return CONSTANT_COST;
+
+                case Opcode::LOAD:
+                    return LOAD_COST;
+
+                case Opcode::CALL: {
+                    uint32_t cost = function[node.origin].info.cost;
+                    return cost != 0 ? cost : DEFAULT_CALL_COST;
+                }
+
+                case Opcode::MUL: {
+                    uint32_t constant;
+                    bool is_shift = (graph_.IsConstant(node.children[0], constant) && IsPowerOfTwo(constant)) ||
+                                    (graph_.IsConstant(node.children[1], constant) && IsPowerOfTwo(constant));
+                    return is_shift ? SHIFT_COST : MULTIPLY_COST;
+                }
+
+                default:
+                    return DATA_COST;
+                }
+            }
+
+            // Cheapest node of every class by the sum of costs of the tree. Costs of
+            // nodes with operands are positive, so chosen nodes make no cycles
+            void Extract(const Function& function) {
+                costs_.assign(graph_.NumNodes(), INFINITE_COST);
+                best_.assign(graph_.NumNodes(), 0);
+                images_.assign(graph_.NumNodes(), 0);
+                is_emitted_.assign(graph_.NumNodes(), false);
+                bool is_changed = true;
+                while (is_changed) {
+                    is_changed = false;
+                    for (NodeId id = 0; id < graph_.NumNodes(); ++id) {
+                        ClassId cls = graph_.ClassOf(id);
+                        const ENode& node = graph_.Node(id);
+                        uint64_t cost = Cost(function, node);
+                        for (ClassId child : node.children) {
+                            uint64_t child_cost = costs_[graph_.Find(child)];
+                            cost = child_cost == INFINITE_COST ? INFINITE_COST : cost + child_cost;
+                        }
+                        if (cost < costs_[cls]) {
+                            costs_[cls] = cost;
+                            best_[cls] = id;
+                            is_changed = true;
+                        }
+                    }
+                }
+            }
+
+            // Appends chosen nodes of the class and its operands. Depth-first with an
+            // explicit stack: the tree grows with the budget
+            ValueId Emit(const Function& function, ClassId root, Function& result) {
+                std::vector<std::pair<ClassId, bool>> stack = {{root, false}}; // Class and whether its operands are done
+                while (!stack.empty()) {
+                    auto [cls, is_ready] = stack.back();
+                    stack.pop_back();
+                    if (is_emitted_[cls]) {
+                        continue;
+                    }
+                    const ENode& node = graph_.Node(best_[cls]);
+                    if (!is_ready) {
+                        stack.push_back({cls, true});
+                        // Popped in reverse order
+                        for (auto it = node.children.rbegin(); it != node.children.rend(); ++it) {
+                            stack.push_back({graph_.Find(*it), false});
+                        }
+                        continue;
+                    }
+                    std::vector<ValueId> operands;
+                    for (ClassId child : node.children) {
+                        operands.push_back(images_[graph_.Find(child)]);
+                    }
+                    Instruction instruction;
+                    if (node.opcode == Opcode::LOAD || node.opcode == Opcode::CALL) {
+                        instruction = function[node.origin];
+                        instruction.operands = std::move(operands);
+                    } else if (node.opcode == Opcode::CONSTANT) {
+                        instruction = MakeConstant(node.constant);
+                    } else {
+                        instruction = MakeOperation(node.opcode, std::move(operands));
+                    }
+                    images_[cls] = result.Append(std::move(instruction));
+                    is_emitted_[cls] = true;
+                }
+                return images_[root];
+            }
+
+            uint32_t budget_;
+            EGraph graph_;
+            bool is_changed_ = false;
+            std::vector<uint64_t> costs_;
+            std::vector<NodeId> best_;
+            std::vector<ValueId> images_;
+            std::vector<bool> is_emitted_;
+        };
+
+        std::unique_ptr<Pass> CreateEqualitySaturation(uint32_t budget) {
+            return std::make_unique<EqualitySaturation>(budget);
+        }
+    } // namespace optimizer
+} // namespace JIT
@@ -0,0 +1,232 @@
+#include <algorithm>
+#include <map>
+
+#include "optimizer/passes.h"
+
+namespace JIT {
+    namespace optimizer {
+        // Expansion of larger trees doesn't pay off
+        constexpr uint32_t MAX_NODES = 256;
+        constexpr uint32_t MAX_TERMS = 64;
+        constexpr uint32_t MAX_DEGREE = 32;
+
+        // Polynomial over atoms: values which are not expanded. Terms are products of
+        // atoms with a coefficient, the ring is integers modulo 2^32, so rewriting
+        // keeps wrap-around semantics exactly
+        using Monomial = std::vector<ValueId>; // Sorted atoms
+        using Polynomial = std::map<Monomial, uint32_t>;
+
+        class HornerRewriting : public Pass {
+        public:
+            const char* Name() const override {
+                return "horner";
+            }
+
+            void Run(Function& function) override {
+                std::vector<uint32_t> num_uses(function.Size(), 0);
+                // Last user of every value
+                std::vector<ValueId> users(function.Size(), 0);
+                for (ValueId value = 0; value < function.Size(); ++value) {
+                    for (ValueId operand : function[value].operands) {
+                        ++num_uses[operand];
+                        users[operand] = value;
+                    }
+                }
+                ++num_uses[function.result];
+
+                Function result;
+                std::vector<ValueId> images(function.Size());
+                for (ValueId value = 0; value < function.Size(); ++value) {
+                    // Roots of arithmetic trees: values used not only by one arithmetic instruction.
+                    // Inner values of rewritten trees are left to DCE
+                    bool is_root = IsArithmetic(function[value].opcode) &&
+                                   (num_uses[value] != 1 || value == function.result ||
+                                    !IsArithmetic(function[users[value]].opcode));
+                    Polynomial polynomial;
+                    uint32_t num_multiplications = 0;
+                    if (is_root && Expand(function, num_uses, value, polynomial, num_multiplications) &&
+                        num_multiplications > 1 &&
+                        Rewrite(polynomial, num_multiplications, images, result, images[value])) {
+                        continue;
+                    }
+                    images[value] = result.Append(Remap(function[value], images));
+                }
+                result.result = images[function.result];
+                function = std::move(result);
+            }
+
+        private:
+            static void AddTo(Polynomial& polynomial, const Monomial& monomial, uint32_t coefficient) {
+                uint32_t& sum = polynomial[monomial];
+                sum += coefficient;
+                if (sum == 0) {
+                    polynomial.erase(monomial);
+                }
+            }
+
+            // Expands the tree of single use arithmetic values under the root. Counts
+            // multiplications of two non-constants in it
+            bool Expand(const Function& function, const std::vector<uint32_t>& num_uses, ValueId root,
+                        Polynomial& polynomial, uint32_t& num_multiplications) {
+                auto is_expanded = [&](ValueId value) {
+                    return IsArithmetic(function[value].opcode) && (value == root || num_uses[value] == 1);
+                };
+                // Preorder with an explicit stack: expressions may be very deep. Larger
+                // trees are given up before they are visited
+                std::vector<ValueId> order, stack = {root};
+                while (!stack.empty()) {
+                    if (order.size() == MAX_NODES) {
+                        return false;
+                    }
+                    ValueId value = stack.back();
+                    stack.pop_back();
+                    order.push_back(value);
+                    if (is_expanded(value)) {
+                        const auto& operands = function[value].operands;
+                        stack.insert(stack.end(), operands.rbegin(), operands.rend());
+                    }
+                }
+
+                // Operands follow their users in preorder, so backwards they are expanded
+                // first, the left one on top
+                std::vector<Polynomial> expanded;
+                for (auto it = order.rbegin(); it != order.rend(); ++it) {
+                    const auto& instruction = function[*it];
+                    Polynomial result;
+                    if (instruction.opcode == Opcode::CONSTANT) {
+                        if (instruction.constant != 0) {
+                            result[{}] = instruction.constant;
+                        }
+                    } else if (!is_expanded(*it)) {
+                        result[{*it}] = 1;
+                    } else {
+                        result = std::move(expanded.back());
+                        expanded.pop_back();
+                        if (instruction.opcode == Opcode::NEG) {
+                            for (auto& [monomial, coefficient] : result) {
+                                coefficient = 0u - coefficient;
+                            }
+                        } else {
+                            Polynomial right = std::move(expanded.back());
+                            expanded.pop_back();
+                            if (instruction.opcode == Opcode::MUL) {
+                                num_multiplications += function[instruction.operands[0]].opcode != Opcode::CONSTANT &&
+                                                       function[instruction.operands[1]].opcode != Opcode::CONSTANT;
+                                if (!Multiply(result, right)) {
+                                    return false;
+                                }
+                            } else {
+                                uint32_t sign = (instruction.opcode == Opcode::ADD ? 1 : 0xFFFFFFFF);
+                                for (const auto& [monomial, coefficient] : right) {
+                                    AddTo(result, monomial, sign * coefficient);
+                                }
+                            }
+                        }
+                    }
+                    if (result.size() > MAX_TERMS) {
+                        return false;
+                    }
+                    expanded.push_back(std::move(result));
+                }
+                polynomial = std::move(expanded.back());
+                return true;
+            }
+
+            // Product of polynomials to the left one, fails on too many terms or
+            // a too high degree
+            static bool Multiply(Polynomial& left, const Polynomial& right) {
+                Polynomial product;
+                for (const auto& [left_monomial, left_coefficient] : left) {
+                    for (const auto& [right_monomial, right_coefficient] : right) {
+                        if (left_monomial.size() + right_monomial.size() > MAX_DEGREE) {
+                            return false;
+                        }
+                        Monomial monomial = left_monomial;
+                        monomial.insert(monomial.end(), right_monomial.begin(), right_monomial.end());
+                        std::sort(monomial.begin(), monomial.end());
+                        AddTo(product, monomial, left_coefficient * right_coefficient);
+                    }
+                    if (product.size() > MAX_TERMS) {
+                        return false;
+                    }
+                }
+                left = std::move(product);
+                return true;
+            }
+
+            // Rewrites the polynomial as c_n(x) * x^n + ... + c_0(x) in Horner form
+            // by the atom x of the highest degree, if it takes less multiplications
+            bool Rewrite(const Polynomial& polynomial, uint32_t num_multiplications,
+                         const std::vector<ValueId>& images, Function& result, ValueId& image) {
+                ValueId x = 0;
+                uint32_t degree = 0;
+                for (const auto& [monomial, coefficient] : polynomial) {
+                    for (auto it = monomial.begin(); it != monomial.end();) {
+                        auto end = std::upper_bound(it, monomial.end(), *it);
+                        if (static_cast<uint32_t>(end - it) > degree) {
+                            x = *it;
+                            degree = end - it;
+                        }
+                        it = end;
+                    }
+                }
+                if (degree < 2) {
+                    return false;
+                }
+
+                // Coefficients by degree of x
+                std::vector<Polynomial> coefficients(degree + 1);
+                uint32_t num_new_multiplications = degree;
+                for (const auto& [monomial, coefficient] : polynomial) {
+                    Monomial rest;
+                    std::copy_if(monomial.begin(), monomial.end(), std::back_inserter(rest),
+                                 [x](ValueId atom) { return atom != x; });
+                    coefficients[monomial.size() - rest.size()][rest] = coefficient;
+                    num_new_multiplications += rest.empty() ? 0 : rest.size() - 1;
+                }
+                if (num_new_multiplications >= num_multiplications) {
+                    return false;
+                }
+
+                image = Emit(coefficients[degree], images, result);
+                for (uint32_t power = degree; power > 0; --power) {
+                    image = result.Append(MakeOperation(Opcode::MUL, {image, images[x]}));
+                    if (!coefficients[power - 1].empty()) {
+                        ValueId coefficient = Emit(coefficients[power - 1], images, result);
+                        image = result.Append(MakeOperation(Opcode::ADD, {image, coefficient}));
+                    }
+                }
+                return true;
+            }
+
+            // Sum of products, nonempty
+            ValueId Emit(const Polynomial& polynomial, const std::vector<ValueId>& images, Function& result) {
+                ValueId sum = 0;
+                bool is_first = true;
+                for (const auto& [monomial, coefficient] : polynomial) {
+                    if (monomial.empty()) {
+                        sum = is_first ? result.Append(MakeConstant(coefficient)) :
+                              result.Append(MakeOperation(Opcode::ADD, {sum, result.Append(MakeConstant(coefficient))}));
+                        is_first = false;
+                        continue;
+                    }
+                    ValueId term = images[monomial[0]];
+                    for (uint32_t i = 1; i < monomial.size(); ++i) {
+                        term = result.Append(MakeOperation(Opcode::MUL, {term, images[monomial[i]]}));
+                    }
+                    if (coefficient != 1) {
+                        ValueId constant = result.Append(MakeConstant(coefficient));
+                        term = result.Append(MakeOperation(Opcode::MUL, {term, constant}));
+                    }
+                    sum = is_first ? term : result.Append(MakeOperation(Opcode::ADD, {sum, term}));
+                    is_first = false;
+                }
+                return sum;
+            }
+        };
+
+        std::unique_ptr<Pass> CreateHornerRewriting() {
+            return std::make_unique<HornerRewriting>();
+        }
+    } // namespace optimizer
+} // namespace JIT
@@ -0,0 +1,158 @@
+#include "optimizer/ir.h"
+
+#include <algorithm>
+
+namespace JIT {
+    namespace optimizer {
+        bool IsArithmetic(Opcode opcode) {
+            return opcode == Opcode::ADD || opcode == Opcode::SUB ||
+                   opcode == Opcode::MUL || opcode == Opcode::NEG;
+        }
+
+        bool IsPowerOfTwo(uint32_t value) {
+            return value != 0 && (value & (value - 1)) == 0;
+        }
+
+        uint32_t Evaluate(Opcode opcode, uint32_t left, uint32_t right) {
+            switch (opcode) {
+            case Opcode::ADD:
+                return left + right;
+
+            case Opcode::SUB:
+                return left - right;
+
+            case Opcode::MUL:
+                return left * right;
+
+            case Opcode::NEG:
+                return 0u - left;
+
+            default:
+                return 0;
+            }
+        }
+
+        Instruction MakeConstant(uint32_t constant) {
+            Instruction instruction;
+            instruction.opcode = Opcode::CONSTANT;
+            instruction.constant = constant;
+            return instruction;
+        }
+
+        Instruction MakeOperation(Opcode opcode, std::vector<ValueId> operands) {
+            Instruction instruction;
+            instruction.opcode = opcode;
+            instruction.operands = std::move(operands);
+            return instruction;
+        }
+
+        Instruction Remap(const Instruction& instruction, const std::vector<ValueId>& images) {
+            Instruction result = instruction;
+            for (auto& operand : result.operands) {
+                operand = images[operand];
+            }
+            return result;
+        }
+
+        uint32_t CallExtern(void* symbol, const std::vector<uint32_t>& arguments) {
+            using Extern = uint32_t (*)(uint32_t, uint32_t, uint32_t, uint32_t,
+                                        uint32_t, uint32_t, uint32_t, uint32_t);
+            // Extra arguments are ignored by the callee, missing ones are zero like in
+            // the generated code
+            uint32_t padded[MAX_EVALUATED_ARGUMENTS] = {};
+            std::copy(arguments.begin(), arguments.end(), padded);
+            return reinterpret_cast<Extern>(symbol)(padded[0], padded[1], padded[2], padded[3],
+                                                    padded[4], padded[5], padded[6], padded[7]);
+        }
+
+        parser::Error BuildFunction(std::string_view source,
+                                    const std::vector<parser::Token>& postfix_notation_expression,
+                                    const std::unordered_map<std::string_view, void*>& external_symbols,
+                                    Function& function,
+                                    const std::unordered_map<std::string_view, SymbolInfo>& symbol_infos) {
+            // Values of the evaluation stack
+            std::vector<ValueId> stack;
+            for (const auto& token : postfix_notation_expression) {
+                Instruction instruction;
+                if (token.type == parser::Token::VARIABLE || token.type == parser::Token::FUNCTION) {
+                    auto it = external_symbols.find(token.text);
+                    if (it == external_symbols.end()) {
+                        uint32_t position = source.empty() ? 0 : token.text.data() - source.data();
+                        return {parser::ErrorKind::UNDEFINED_SYMBOL, position};
+                    }
+                    instruction.symbol = it->second;
+                    instruction.name = token.text;
+                }
+
+                uint32_t num_operands = 0;
+                if (token.type == parser::Token::NUMBER) {
+                    instruction.opcode = Opcode::CONSTANT;
+                    instruction.constant = token.number;
+                } else if (token.type == parser::Token::VARIABLE) {
+                    instruction.opcode = Opcode::LOAD;
+                } else if (token.type == parser::Token::FUNCTION) {
+                    instruction.opcode = Opcode::CALL;
+                    num_operands = token.num_arguments;
+                    auto info = symbol_infos.find(token.text);
+                    // Calls not matching the declared arity are not trusted
+                    if (info != symbol_infos.end() &&
+                        (info->second.arity < 0 || info->second.arity == static_cast<int32_t>(num_operands))) {
+                        instruction.info = info->second;
+                    }
+                } else {
+                    switch (token.operation) {
+                    case parser::Operation::PLUS:
+                        instruction.opcode = Opcode::ADD;
+                        break;
+
+                    case parser::Operation::MINUS:
+                        instruction.opcode = Opcode::SUB;
+                        break;
+
+                    case parser::Operation::MULTIPLY:
+                        instruction.opcode = Opcode::MUL;
+                        break;
+
+                    default:
+                        instruction.opcode = Opcode::NEG;
+                        break;
+                    }
+                    num_operands = (instruction.opcode == Opcode::NEG ? 1 : 2);
+                }
+                if (stack.size() < num_operands) {
+                    return {parser::ErrorKind::MISSING_OPERAND, static_cast<uint32_t>(source.size())};
+                }
+                instruction.operands.assign(stack.end() - num_operands, stack.end());
+                stack.resize(stack.size() - num_operands);
+                stack.push_back(function.Append(std::move(instruction)));
+            }
+            if (stack.size() != 1) {
+                return {stack.empty() ? parser::ErrorKind::MISSING_OPERAND : parser::ErrorKind::MISSING_OPERATOR,
+                        static_cast<uint32_t>(source.size())};
+            }
+            function.result = stack.back();
+            return {};
+        }
+
+        std::string Print(const Function& function) {
+            static const char* names[] = {"const", "load", "call", "add", "sub", "mul", "neg"};
+            std::string result;
+            for (ValueId value = 0; value < function.Size(); ++value) {
+                const auto& instruction = function[value];
+                result += "%" + std::to_string(value) + " = " +
+                          names[static_cast<uint32_t>(instruction.opcode)];
+                if (instruction.opcode == Opcode::CONSTANT) {
+                    result += " " + std::to_string(static_cast<int32_t>(instruction.constant));
+                } else if (!instruction.name.empty()) {
+                    result += " " + std::string(instruction.name);
+                }
+                for (uint32_t i = 0; i < instruction.operands.size(); ++i) {
+                    result += (i == 0 && instruction.name.empty() ? " %" : ", %") +
+                              std::to_string(instruction.operands[i]);
+                }
+                result += "\n";
+            }
+            return result + "ret %" + std::to_string(function.result) + "\n";
+        }
+    } // namespace optimizer
+} // namespace JIT
@@ -0,0 +1,114 @@
+#ifndef IR_H_
+#define IR_H_
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "parser/parser.h"
+
+namespace JIT {
+    namespace optimizer {
+        enum struct Opcode : uint8_t {
+            CONSTANT,
+            LOAD, // Value of the variable at symbol
+            CALL, // symbol(operands...)
+            ADD,
+            SUB,
+            MUL,
+            NEG
+        };
+
+        enum struct Purity : uint8_t {
+            IMPURE, // May change variables or have other side effects
+            PURE,   // Reads variables at most
+            CONST   // Depends on arguments only
+        };
+
+        // What is known about an extern function
+        struct SymbolInfo {
+            int32_t arity = -1; // Unknown if negative
+            Purity purity = Purity::IMPURE;
+            uint32_t cost = 0; // Approximate cycles per call, unknown if zero
+        };
+
+        // Index of the instruction computing the value
+        using ValueId = uint32_t;
+
+        struct Instruction {
+            Opcode opcode;
+            uint32_t constant = 0; // For CONSTANT, arithmetic wraps around modulo 2^32
+            void* symbol = nullptr; // Address for LOAD and CALL
+            std::string_view name; // Symbol name for LOAD and CALL
+            SymbolInfo info; // For CALL
+            std::vector<ValueId> operands;
+
+            // Call without side effects, which may be merged with equal ones or removed
+            bool IsPureCall() const {
+                return opcode == Opcode::CALL && info.purity != Purity::IMPURE;
+            }
+        };
+
+        // Expression DAG in SSA form: every instruction defines a value and uses only
+        // values defined before it. Instructions are in evaluation order, which matters
+        // for calls and loads only, as calls may change variables
+        struct Function {
+            std::vector<Instruction> instructions;
+            ValueId result = 0;
+
+            uint32_t Size() const {
+                return instructions.size();
+            }
+
+            const Instruction& operator[](ValueId value) const {
+                return instructions[value];
+            }
+
+            ValueId Append(Instruction instruction) {
+                instructions.push_back(std::move(instruction));
+                return instructions.size() - 1;
+            }
+        };
+
+        // ADD, SUB, MUL and NEG: pure functions of their operands
+        bool IsArithmetic(Opcode opcode);
+
+        bool IsPowerOfTwo(uint32_t value);
+
+        // Cycles of mul, whose result comes two cycles later on in-order cores. Other
+        // data processing instructions take one
+        constexpr uint32_t MULTIPLY_COST = 2;
+
+        // Value of the arithmetic instruction on constant operands, wrapping around
+        // exactly like the ARM instructions it is compiled to
+        uint32_t Evaluate(Opcode opcode, uint32_t left, uint32_t right = 0);
+
+        Instruction MakeConstant(uint32_t constant);
+        Instruction MakeOperation(Opcode opcode, std::vector<ValueId> operands);
+
+        // Instruction with operands replaced by their images, for passes that copy
+        // instructions to a new function
+        Instruction Remap(const Instruction& instruction, const std::vector<ValueId>& images);
+
+        // Calls the extern function with arguments in the host calling convention,
+        // for evaluation of CONST functions at compile time
+        constexpr uint32_t MAX_EVALUATED_ARGUMENTS = 8;
+        uint32_t CallExtern(void* symbol, const std::vector<uint32_t>& arguments);
+
+        // Builds the function from postfix notation made from source. Symbols missing
+        // in externs are reported as UNDEFINED_SYMBOL. Functions missing in symbol_infos
+        // or called with a different number of arguments are assumed impure
+        parser::Error BuildFunction(std::string_view source,
+                                    const std::vector<parser::Token>& postfix_notation_expression,
+                                    const std::unordered_map<std::string_view, void*>& external_symbols,
+                                    Function& function,
+                                    const std::unordered_map<std::string_view, SymbolInfo>& symbol_infos = {});
+
+        // One instruction per line, like "%2 = add %0, %1", and "ret %2" at the end
+        std::string Print(const Function& function);
+    } // namespace optimizer
+} // namespace JIT
+
+#endif // IR_H_
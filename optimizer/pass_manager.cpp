@@ -0,0 +1,48 @@
+#include "optimizer/pass_manager.h"
+
+#include <chrono>
+
+#include "optimizer/passes.h"
+
+namespace JIT {
+    namespace optimizer {
+        void PassManager::Add(std::unique_ptr<Pass> pass) {
+            passes_.push_back(std::move(pass));
+        }
+
+        void PassManager::Run(Function& function, std::vector<PassTiming>* timings) const {
+            for (const auto& pass : passes_) {
+                auto start = std::chrono::steady_clock::now();
+                pass->Run(function);
+                if (timings != nullptr) {
+                    std::chrono::nanoseconds elapsed = std::chrono::steady_clock::now() - start;
+                    timings->push_back({pass->Name(), static_cast<uint64_t>(elapsed.count())});
+                }
+            }
+        }
+
+        PassManager CreatePassManager(const OptimizerOptions& options) {
+            PassManager manager;
+            if (options.level == OptimizationLevel::O0) {
+                return manager;
+            }
+            manager.Add(CreateConstantFolding());
+            manager.Add(CreateCommonSubexpressionElimination(options.calls_modify_variables));
+            manager.Add(CreateAlgebraicSimplification());
+            if (options.level >= OptimizationLevel::O2) {
+                manager.Add(CreateHornerRewriting());
+                manager.Add(CreateAlgebraicSimplification());
+                // Simplification may give new common subexpressions
+                manager.Add(CreateCommonSubexpressionElimination(options.calls_modify_variables));
+            }
+            manager.Add(CreateDeadCodeElimination());
+            if (options.level == OptimizationLevel::O3) {
+                manager.Add(CreateEqualitySaturation(options.saturation_budget));
+            }
+            if (options.level >= OptimizationLevel::O2) {
+                manager.Add(CreateRebalancing(options.calls_modify_variables));
+            }
+            return manager;
+        }
+    } // namespace optimizer
+} // namespace JIT
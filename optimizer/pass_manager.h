@@ -0,0 +1,61 @@
+#ifndef PASS_MANAGER_H_
+#define PASS_MANAGER_H_
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "optimizer/ir.h"
+
+namespace JIT {
+    namespace optimizer {
+        class Pass {
+        public:
+            virtual ~Pass() = default;
+
+            virtual const char* Name() const = 0;
+            virtual void Run(Function& function) = 0;
+        };
+
+        struct PassTiming {
+            const char* name;
+            uint64_t nanoseconds;
+        };
+
+        enum struct OptimizationLevel : uint8_t {
+            O0, // No IR: postfix notation is translated straight to code
+            O1, // Cheap passes only
+            O2, // Best code with fast compilation
+            O3  // O2 and equality saturation: slow compilation for expressions run many times
+        };
+
+        // Default limit of e-graph nodes at O3
+        constexpr uint32_t DEFAULT_SATURATION_BUDGET = 4096;
+
+        struct OptimizerOptions {
+            OptimizationLevel level = OptimizationLevel::O2;
+            // Aliasing rule: whether externs called by the expression may change its
+            // variables. If not, every variable is loaded once per evaluation
+            bool calls_modify_variables = true;
+            // Effort of equality saturation: limit of e-graph nodes
+            uint32_t saturation_budget = DEFAULT_SATURATION_BUDGET;
+        };
+
+        class PassManager {
+        public:
+            void Add(std::unique_ptr<Pass> pass);
+
+            // Runs passes in order of addition. Time of every pass is appended to
+            // timings if they are given
+            void Run(Function& function, std::vector<PassTiming>* timings = nullptr) const;
+
+        private:
+            std::vector<std::unique_ptr<Pass>> passes_;
+        };
+
+        // Pipeline of the optimization level
+        PassManager CreatePassManager(const OptimizerOptions& options);
+    } // namespace optimizer
+} // namespace JIT
+
+#endif // PASS_MANAGER_H_
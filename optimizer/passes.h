@@ -0,0 +1,41 @@
+#ifndef PASSES_H_
+#define PASSES_H_
+
+#include <memory>
+
+#include "optimizer/pass_manager.h"
+
+namespace JIT {
+    namespace optimizer {
+        // Replaces arithmetic on constants with its value. CONST functions are
+        // called at compile time if all arguments are constants
+        std::unique_ptr<Pass> CreateConstantFolding();
+
+        // Computes equal values once. Loads of a variable and pure calls are reused
+        // until a call that may change variables
+        std::unique_ptr<Pass> CreateCommonSubexpressionElimination(bool calls_modify_variables);
+
+        // Applies identities like x*1, x-x and -(-x), merges constants of
+        // +/* chains and factors common multipliers out of sums
+        std::unique_ptr<Pass> CreateAlgebraicSimplification();
+
+        // Rewrites polynomials in one variable into Horner form when it takes less
+        // multiplications, e.g. a*x*x + b*x + c into (a*x + b)*x + c
+        std::unique_ptr<Pass> CreateHornerRewriting();
+
+        // Splits long chains of + and * into a few partial results, as long as they
+        // fit in registers, and orders computation of operands by the number of
+        // registers they need
+        std::unique_ptr<Pass> CreateRebalancing(bool calls_modify_variables);
+
+        // Finds the cheapest form of the function on ARM among ones equal by integer
+        // identities, using an e-graph of up to budget nodes. Functions with impure
+        // calls are left as they are
+        std::unique_ptr<Pass> CreateEqualitySaturation(uint32_t budget);
+
+        // Removes values that don't contribute to the result. Impure calls are kept
+        std::unique_ptr<Pass> CreateDeadCodeElimination();
+    } // namespace optimizer
+} // namespace JIT
+
+#endif // PASSES_H_
@@ -0,0 +1,365 @@
+#include <algorithm>
+
+#include "optimizer/passes.h"
+
+namespace JIT {
+    namespace optimizer {
+        // Chains of less leaves are balanced already
+        constexpr uint32_t MIN_CHAIN_LENGTH = 4;
+        // Chains are split into partial sums (or products) of consecutive leaves,
+        // combined by a balanced tree. More of them shorten the dependency chain, but keep more
+        // values live: computed one by one, k of them need log2(k) + 2 registers
+        constexpr uint32_t MAX_ACCUMULATORS = 4;
+        // Value registers of the code generator which stay free for sure: 8 less
+        // the ones it may pin to a base address and two callees
+        constexpr uint32_t MAX_LIVE_VALUES = 5;
+
+        class Rebalancing : public Pass {
+        public:
+            explicit Rebalancing(bool calls_modify_variables)
+                : calls_modify_variables_(calls_modify_variables) {
+            }
+
+            const char* Name() const override {
+                return "rebalance";
+            }
+
+            void Run(Function& function) override {
+                Rebalance(function);
+                Schedule(function);
+            }
+
+        private:
+            static bool IsImpureCall(const Instruction& instruction) {
+                return instruction.opcode == Opcode::CALL && !instruction.IsPureCall();
+            }
+
+            // Loads and pure calls are kept between the same impure calls if these may
+            // change variables
+            bool ReadsVariables(const Instruction& instruction) const {
+                return calls_modify_variables_ &&
+                       (instruction.opcode == Opcode::LOAD ||
+                        (instruction.opcode == Opcode::CALL && instruction.info.purity == Purity::PURE));
+            }
+
+            static std::vector<uint32_t> CountUses(const Function& function) {
+                std::vector<uint32_t> num_uses(function.Size(), 0);
+                for (const auto& instruction : function.instructions) {
+                    for (ValueId operand : instruction.operands) {
+                        ++num_uses[operand];
+                    }
+                }
+                ++num_uses[function.result];
+                return num_uses;
+            }
+
+            // Rebuilds chains of single use ADDs or MULs as a few partial results,
+            // if they fit in registers along with leaves used elsewhere, which stay
+            // live through the chain. Old inner nodes are dropped by scheduling
+            void Rebalance(Function& function) {
+                std::vector<uint32_t> num_uses = CountUses(function);
+                std::vector<bool> uses_calls(function.Size(), false);
+                // Operands of a chain continuing it
+                std::vector<bool> is_inner(function.Size(), false);
+                for (const auto& instruction : function.instructions) {
+                    if (instruction.opcode == Opcode::ADD || instruction.opcode == Opcode::MUL) {
+                        for (ValueId operand : instruction.operands) {
+                            is_inner[operand] = is_inner[operand] ||
+                                                (function[operand].opcode == instruction.opcode &&
+                                                 num_uses[operand] == 1);
+                        }
+                    }
+                }
+
+                Function result;
+                std::vector<ValueId> images(function.Size());
+                std::vector<ValueId> leaves, plain, folded, shared;
+                for (ValueId value = 0; value < function.Size(); ++value) {
+                    const auto& instruction = function[value];
+                    images[value] = result.Append(Remap(instruction, images));
+                    uses_calls[value] = IsImpureCall(instruction);
+                    for (ValueId operand : instruction.operands) {
+                        uses_calls[value] = uses_calls[value] || uses_calls[operand];
+                    }
+                    if ((instruction.opcode != Opcode::ADD && instruction.opcode != Opcode::MUL) ||
+                        is_inner[value]) {
+                        continue;
+                    }
+                    CollectLeaves(function, is_inner, value, leaves);
+                    // Partial results of chains with impure calls would live across them
+                    if (leaves.size() < MIN_CHAIN_LENGTH ||
+                        std::any_of(leaves.begin(), leaves.end(), [&uses_calls](ValueId leaf) {
+                            return uses_calls[leaf];
+                        })) {
+                        continue;
+                    }
+                    // Constants and products fold into the instruction using them
+                    // (immediates and mla), so they are added last one by one
+                    plain.clear();
+                    folded.clear();
+                    shared.clear();
+                    for (ValueId leaf : leaves) {
+                        bool is_folded = function[leaf].opcode == Opcode::CONSTANT ||
+                                         (instruction.opcode == Opcode::ADD &&
+                                          function[leaf].opcode == Opcode::MUL && num_uses[leaf] == 1);
+                        (is_folded ? folded : plain).push_back(images[leaf]);
+                        if (!is_folded && num_uses[leaf] > 1) {
+                            shared.push_back(leaf);
+                        }
+                    }
+                    std::sort(shared.begin(), shared.end());
+                    uint32_t num_shared = std::unique(shared.begin(), shared.end()) - shared.begin();
+                    uint32_t num_accumulators = MAX_ACCUMULATORS;
+                    while (num_accumulators > 1 &&
+                           num_shared + __builtin_ctz(num_accumulators) + 2 > MAX_LIVE_VALUES) {
+                        num_accumulators /= 2;
+                    }
+                    if (num_accumulators == 1) {
+                        continue;
+                    }
+                    if (plain.empty()) {
+                        plain.push_back(folded.front());
+                        folded.erase(folded.begin());
+                    }
+                    // Partial results over consecutive leaves, so that leaves ordered by
+                    // calls are still computed one partial result after another
+                    std::vector<ValueId> accumulators;
+                    size_t block_size = (plain.size() + num_accumulators - 1) / num_accumulators;
+                    for (size_t i = 0; i < plain.size(); ++i) {
+                        if (i % block_size == 0) {
+                            accumulators.push_back(plain[i]);
+                        } else {
+                            accumulators.back() = result.Append(MakeOperation(instruction.opcode,
+                                                                              {accumulators.back(), plain[i]}));
+                        }
+                    }
+                    ValueId image = Balance(instruction.opcode, accumulators, 0, accumulators.size(), result);
+                    for (ValueId leaf : folded) {
+                        image = result.Append(MakeOperation(instruction.opcode, {image, leaf}));
+                    }
+                    images[value] = image;
+                }
+                result.result = images[function.result];
+                function = std::move(result);
+            }
+
+            // Leaves of the chain from left to right
+            static void CollectLeaves(const Function& function, const std::vector<bool>& is_inner,
+                                      ValueId root, std::vector<ValueId>& leaves) {
+                leaves.clear();
+                std::vector<ValueId> stack = {root};
+                while (!stack.empty()) {
+                    ValueId value = stack.back();
+                    stack.pop_back();
+                    if (value != root && !is_inner[value]) {
+                        leaves.push_back(value);
+                        continue;
+                    }
+                    const auto& operands = function[value].operands;
+                    stack.insert(stack.end(), operands.rbegin(), operands.rend());
+                }
+            }
+
+            static ValueId Balance(Opcode opcode, const std::vector<ValueId>& leaves, size_t begin,
+                                   size_t end, Function& result) {
+                if (end - begin == 1) {
+                    return leaves[begin];
+                }
+                size_t middle = begin + (end - begin + 1) / 2;
+                ValueId left = Balance(opcode, leaves, begin, middle, result);
+                ValueId right = Balance(opcode, leaves, middle, end, result);
+                return result.Append(MakeOperation(opcode, {left, right}));
+            }
+
+            // Reorders values so that operands needing more registers (by Sethi-Ullman
+            // numbers) are computed first. Impure calls keep their order and split values
+            // into regions, reordered only within: readers of variables stay in theirs, values
+            // using calls or readers are computed as soon as their operands are ready, others
+            // in the region of their first user. So few values live across calls
+            void Schedule(Function& function) {
+                std::vector<bool> is_live(function.Size(), false);
+                is_live[function.result] = true;
+                for (ValueId value = function.Size(); value-- > 0;) {
+                    const auto& instruction = function[value];
+                    if (IsImpureCall(instruction)) {
+                        is_live[value] = true;
+                    }
+                    if (is_live[value]) {
+                        for (ValueId operand : instruction.operands) {
+                            is_live[operand] = true;
+                        }
+                    }
+                }
+
+                std::vector<uint32_t> needs(function.Size(), 0);
+                // Region i ends with the i-th impure call, whose result is ready in the next one
+                std::vector<uint32_t> regions(function.Size(), 0);
+                std::vector<uint32_t> ready_regions(function.Size(), 0);
+                std::vector<bool> is_impure_call(function.Size(), false);
+                // Values not using calls or readers of variables, computed in the region
+                // of their first user
+                std::vector<bool> is_floating(function.Size(), false);
+                std::vector<ValueId> calls;
+                // Values using calls or readers by region, tried first in it
+                std::vector<std::vector<ValueId>> eager(1);
+                std::vector<uint32_t> operand_needs;
+                for (ValueId value = 0; value < function.Size(); ++value) {
+                    const auto& instruction = function[value];
+                    operand_needs.clear();
+                    for (ValueId operand : instruction.operands) {
+                        operand_needs.push_back(needs[operand]);
+                    }
+                    std::sort(operand_needs.rbegin(), operand_needs.rend());
+                    needs[value] = instruction.opcode == Opcode::CONSTANT ? 0 : 1;
+                    for (uint32_t i = 0; i < operand_needs.size(); ++i) {
+                        needs[value] = std::max(needs[value], operand_needs[i] + i);
+                    }
+
+                    if (!is_live[value]) {
+                        continue;
+                    }
+                    is_impure_call[value] = IsImpureCall(instruction);
+                    if (is_impure_call[value] || ReadsVariables(instruction)) {
+                        regions[value] = calls.size();
+                    } else {
+                        is_floating[value] = true;
+                        for (ValueId operand : instruction.operands) {
+                            if (!is_floating[operand]) {
+                                is_floating[value] = false;
+                                regions[value] = std::max(regions[value], ready_regions[operand]);
+                            }
+                        }
+                        if (!is_floating[value]) {
+                            eager[regions[value]].push_back(value);
+                        }
+                    }
+                    ready_regions[value] = regions[value];
+                    if (is_impure_call[value]) {
+                        calls.push_back(value);
+                        eager.emplace_back();
+                        ++ready_regions[value];
+                    }
+                }
+                for (ValueId value = 0; value < function.Size(); ++value) {
+                    if (is_floating[value]) {
+                        regions[value] = value == function.result ? calls.size() : UINT32_MAX;
+                    }
+                }
+                for (ValueId value = function.Size(); value-- > 0;) {
+                    if (!is_live[value]) {
+                        continue;
+                    }
+                    for (ValueId operand : function[value].operands) {
+                        if (is_floating[operand]) {
+                            regions[operand] = std::min(regions[operand], regions[value]);
+                        }
+                    }
+                }
+
+                // Values using ones computed in earlier regions, which stay live until they
+                // are done. Sethi-Ullman numbers don't count them, so these keep their order
+                std::vector<bool> is_carrying(function.Size(), false);
+                for (ValueId value = 0; value < function.Size(); ++value) {
+                    for (ValueId operand : function[value].operands) {
+                        is_carrying[value] = is_carrying[value] || is_carrying[operand] ||
+                                             is_impure_call[operand] || regions[operand] < regions[value];
+                    }
+                }
+
+                // Values used in later regions, computed before the call ending theirs
+                std::vector<std::vector<ValueId>> roots(calls.size() + 1);
+                std::vector<bool> is_root(function.Size(), false);
+                auto add_root = [&](ValueId value, uint32_t user_region) {
+                    if (!is_root[value] && !is_impure_call[value] && regions[value] < user_region) {
+                        is_root[value] = true;
+                        roots[regions[value]].push_back(value);
+                    }
+                };
+                for (ValueId value = 0; value < function.Size(); ++value) {
+                    if (is_live[value]) {
+                        for (ValueId operand : function[value].operands) {
+                            add_root(operand, regions[value]);
+                        }
+                    }
+                }
+                add_root(function.result, calls.size() + 1);
+
+                Function result;
+                std::vector<ValueId> images(function.Size());
+                std::vector<bool> is_emitted(function.Size(), false);
+                // Depth-first with an explicit stack: expressions may be very deep
+                std::vector<std::pair<ValueId, bool>> stack; // Value and whether its operands are done
+                std::vector<ValueId> operands;
+                auto emit = [&](ValueId root) {
+                    stack.push_back({root, false});
+                    while (!stack.empty()) {
+                        auto [value, is_ready] = stack.back();
+                        stack.pop_back();
+                        if (is_emitted[value]) {
+                            continue;
+                        }
+                        if (is_ready) {
+                            images[value] = result.Append(Remap(function[value], images));
+                            is_emitted[value] = true;
+                            continue;
+                        }
+                        stack.push_back({value, true});
+                        operands = function[value].operands;
+                        if (!is_carrying[value]) {
+                            std::stable_sort(operands.begin(), operands.end(), [&needs](ValueId left, ValueId right) {
+                                return needs[left] > needs[right];
+                            });
+                        }
+                        // Popped in reverse order
+                        for (auto it = operands.rbegin(); it != operands.rend(); ++it) {
+                            stack.push_back({*it, false});
+                        }
+                    }
+                };
+                for (uint32_t region = 0; region < roots.size(); ++region) {
+                    // Values whose operands are ready go first, so that the ones
+                    // computed before are not kept live along with the rest
+                    for (ValueId value : eager[region]) {
+                        const auto& value_operands = function[value].operands;
+                        if (std::all_of(value_operands.begin(), value_operands.end(), [&](ValueId operand) {
+                                return is_floating[operand] || is_emitted[operand];
+                            })) {
+                            emit(value);
+                        }
+                    }
+                    auto& region_roots = roots[region];
+                    // Arguments of the call are ordered along with the roots
+                    if (region < calls.size()) {
+                        for (ValueId operand : function[calls[region]].operands) {
+                            if (regions[operand] == region && !is_root[operand]) {
+                                region_roots.push_back(operand);
+                            }
+                        }
+                    }
+                    std::sort(region_roots.begin(), region_roots.end());
+                    if (std::none_of(region_roots.begin(), region_roots.end(), [&is_carrying](ValueId root) {
+                            return is_carrying[root];
+                        })) {
+                        std::stable_sort(region_roots.begin(), region_roots.end(), [&needs](ValueId left, ValueId right) {
+                            return needs[left] > needs[right];
+                        });
+                    }
+                    for (ValueId root : region_roots) {
+                        emit(root);
+                    }
+                    if (region < calls.size()) {
+                        emit(calls[region]);
+                    }
+                }
+                result.result = images[function.result];
+                function = std::move(result);
+            }
+
+            bool calls_modify_variables_;
+        };
+
+        std::unique_ptr<Pass> CreateRebalancing(bool calls_modify_variables) {
+            return std::make_unique<Rebalancing>(calls_modify_variables);
+        }
+    } // namespace optimizer
+} // namespace JIT
@@ -0,0 +1,167 @@
+#include "parser/classifier.h"
+
+#include <cstring>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#elif defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace JIT {
+    namespace parser {
+#if defined(__ARM_NEON)
+        // Bit per byte: analogue of movemask for a comparison result
+        uint32_t MoveMask(uint8x16_t bytes) {
+            static const uint8_t weights[16] = {
+                1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128
+            };
+            uint8x16_t bits = vandq_u8(bytes, vld1q_u8(weights));
+            uint8x8_t sum = vpadd_u8(vget_low_u8(bits), vget_high_u8(bits));
+            sum = vpadd_u8(sum, sum);
+            sum = vpadd_u8(sum, sum);
+            return vget_lane_u8(sum, 0) | (vget_lane_u8(sum, 1) << 8);
+        }
+
+        uint8x16_t InRange(uint8x16_t bytes, uint8_t low, uint8_t high) {
+            return vcleq_u8(vsubq_u8(bytes, vdupq_n_u8(low)), vdupq_n_u8(high - low));
+        }
+
+        BlockClasses ClassifyHalf(const char* half) {
+            uint8x16_t bytes = vld1q_u8(reinterpret_cast<const uint8_t*>(half));
+            uint8x16_t space = vorrq_u8(vceqq_u8(bytes, vdupq_n_u8(' ')),
+                                        InRange(bytes, '\t', '\r'));
+            uint8x16_t alpha = InRange(vorrq_u8(bytes, vdupq_n_u8(0x20)), 'a', 'z');
+            uint8x16_t digit = InRange(bytes, '0', '9');
+            // '(' ')' '*' '+' ',' '-' are consecutive
+            uint8x16_t operation = InRange(bytes, '(', '-');
+            return {MoveMask(space), MoveMask(alpha), MoveMask(digit), MoveMask(operation)};
+        }
+
+        BlockClasses ClassifyBlock(const char* block) {
+            BlockClasses low = ClassifyHalf(block), high = ClassifyHalf(block + 16);
+            return {
+                low.space | (high.space << 16),
+                low.alpha | (high.alpha << 16),
+                low.digit | (high.digit << 16),
+                low.operation | (high.operation << 16)
+            };
+        }
+#elif defined(__AVX2__)
+        // Unsigned range check through signed comparison
+        __m256i InRange(__m256i bytes, uint8_t low, uint8_t high) {
+            __m256i shifted = _mm256_add_epi8(bytes, _mm256_set1_epi8(static_cast<char>(0x80 - low)));
+            return _mm256_cmpgt_epi8(_mm256_set1_epi8(static_cast<char>(0x80 + high - low + 1)),
+                                     shifted);
+        }
+
+        BlockClasses ClassifyBlock(const char* block) {
+            __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block));
+            __m256i space = _mm256_or_si256(_mm256_cmpeq_epi8(bytes, _mm256_set1_epi8(' ')),
+                                            InRange(bytes, '\t', '\r'));
+            __m256i alpha = InRange(_mm256_or_si256(bytes, _mm256_set1_epi8(0x20)), 'a', 'z');
+            __m256i digit = InRange(bytes, '0', '9');
+            // '(' ')' '*' '+' ',' '-' are consecutive
+            __m256i operation = InRange(bytes, '(', '-');
+            return {
+                static_cast<uint32_t>(_mm256_movemask_epi8(space)),
+                static_cast<uint32_t>(_mm256_movemask_epi8(alpha)),
+                static_cast<uint32_t>(_mm256_movemask_epi8(digit)),
+                static_cast<uint32_t>(_mm256_movemask_epi8(operation))
+            };
+        }
+#elif defined(__SSE2__)
+        // Unsigned range check through signed comparison
+        __m128i InRange(__m128i bytes, uint8_t low, uint8_t high) {
+            __m128i shifted = _mm_add_epi8(bytes, _mm_set1_epi8(static_cast<char>(0x80 - low)));
+            return _mm_cmplt_epi8(shifted, _mm_set1_epi8(static_cast<char>(0x80 + high - low + 1)));
+        }
+
+        BlockClasses ClassifyHalf(const char* half) {
+            __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(half));
+            __m128i space = _mm_or_si128(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(' ')),
+                                         InRange(bytes, '\t', '\r'));
+            __m128i alpha = InRange(_mm_or_si128(bytes, _mm_set1_epi8(0x20)), 'a', 'z');
+            __m128i digit = InRange(bytes, '0', '9');
+            // '(' ')' '*' '+' ',' '-' are consecutive
+            __m128i operation = InRange(bytes, '(', '-');
+            return {
+                static_cast<uint32_t>(_mm_movemask_epi8(space)),
+                static_cast<uint32_t>(_mm_movemask_epi8(alpha)),
+                static_cast<uint32_t>(_mm_movemask_epi8(digit)),
+                static_cast<uint32_t>(_mm_movemask_epi8(operation))
+            };
+        }
+
+        BlockClasses ClassifyBlock(const char* block) {
+            BlockClasses low = ClassifyHalf(block), high = ClassifyHalf(block + 16);
+            return {
+                low.space | (high.space << 16),
+                low.alpha | (high.alpha << 16),
+                low.digit | (high.digit << 16),
+                low.operation | (high.operation << 16)
+            };
+        }
+#else
+        BlockClasses ClassifyBlock(const char* block) {
+            BlockClasses result = {0, 0, 0, 0};
+            for (uint32_t i = 0; i < BLOCK_SIZE; ++i) {
+                uint8_t symbol_class = CLASS_TABLE[static_cast<uint8_t>(block[i])];
+                result.space |= static_cast<uint32_t>((symbol_class & CLASS_SPACE) != 0) << i;
+                result.alpha |= static_cast<uint32_t>((symbol_class & CLASS_ALPHA) != 0) << i;
+                result.digit |= static_cast<uint32_t>((symbol_class & CLASS_DIGIT) != 0) << i;
+                result.operation |= static_cast<uint32_t>((symbol_class & CLASS_OPERATION) != 0) << i;
+            }
+            return result;
+        }
+#endif
+
+        Classifier::Classifier(std::string_view input) : input_(input) {
+            LoadBlock(0);
+        }
+
+        void Classifier::LoadBlock(uint32_t block_index) {
+            block_index_ = block_index;
+            uint32_t begin = block_index * BLOCK_SIZE;
+            if (begin + BLOCK_SIZE <= input_.size()) {
+                block_ = ClassifyBlock(input_.data() + begin);
+            } else {
+                // Zero padding doesn't belong to any class
+                char tail[BLOCK_SIZE] = {};
+                if (begin < input_.size()) {
+                    memcpy(tail, input_.data() + begin, input_.size() - begin);
+                }
+                block_ = ClassifyBlock(tail);
+            }
+        }
+
+        uint32_t Classifier::Skip(uint32_t pos, uint8_t classes) {
+            while (pos < input_.size()) {
+                if (pos / BLOCK_SIZE != block_index_) {
+                    LoadBlock(pos / BLOCK_SIZE);
+                }
+                uint32_t mask = 0;
+                if (classes & CLASS_SPACE) {
+                    mask |= block_.space;
+                }
+                if (classes & CLASS_ALPHA) {
+                    mask |= block_.alpha;
+                }
+                if (classes & CLASS_DIGIT) {
+                    mask |= block_.digit;
+                }
+                if (classes & CLASS_OPERATION) {
+                    mask |= block_.operation;
+                }
+                // Outside characters from pos in the block
+                uint32_t outside = ~mask >> (pos % BLOCK_SIZE);
+                if (outside != 0) {
+                    pos += __builtin_ctz(outside);
+                    break;
+                }
+                pos = (pos / BLOCK_SIZE + 1) * BLOCK_SIZE;
+            }
+            return pos < input_.size() ? pos : input_.size();
+        }
+    } // namespace parser
+} // namespace JIT
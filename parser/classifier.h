@@ -0,0 +1,76 @@
+#ifndef CLASSIFIER_H_
+#define CLASSIFIER_H_
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+
+namespace JIT {
+    namespace parser {
+        // Character classes as bits
+        enum CharClass : uint8_t {
+            CLASS_SPACE = 1,
+            CLASS_ALPHA = 2,
+            CLASS_DIGIT = 4,
+            CLASS_OPERATION = 8 // One of "+-*(),"
+        };
+
+        // Same as isspace, isalpha and isdigit in "C" locale
+        constexpr std::array<uint8_t, 256> MakeClassTable() {
+            std::array<uint8_t, 256> table{};
+            for (uint32_t symbol = 0; symbol < 256; ++symbol) {
+                if (symbol == ' ' || (symbol >= '\t' && symbol <= '\r')) {
+                    table[symbol] = CLASS_SPACE;
+                } else if ((symbol >= 'a' && symbol <= 'z') || (symbol >= 'A' && symbol <= 'Z')) {
+                    table[symbol] = CLASS_ALPHA;
+                } else if (symbol >= '0' && symbol <= '9') {
+                    table[symbol] = CLASS_DIGIT;
+                } else if (symbol == '+' || symbol == '-' || symbol == '*' ||
+                           symbol == '(' || symbol == ')' || symbol == ',') {
+                    table[symbol] = CLASS_OPERATION;
+                }
+            }
+            return table;
+        }
+
+        inline constexpr std::array<uint8_t, 256> CLASS_TABLE = MakeClassTable();
+
+        // Usable at compile time
+        constexpr uint8_t GetCharClass(char symbol) {
+            return CLASS_TABLE[static_cast<uint8_t>(symbol)];
+        }
+
+        constexpr uint32_t BLOCK_SIZE = 32;
+
+        // Classes of BLOCK_SIZE consecutive characters: bit i of a mask is set
+        // if i-th character belongs to the class
+        struct BlockClasses {
+            uint32_t space;
+            uint32_t alpha;
+            uint32_t digit;
+            uint32_t operation;
+        };
+
+        // Vectorized with NEON, AVX2 or SSE2 when available
+        BlockClasses ClassifyBlock(const char* block);
+
+        // Finds token boundaries in the input by block masks
+        class Classifier {
+        public:
+            explicit Classifier(std::string_view input);
+
+            // First position at or after pos with a character outside of classes
+            // (or input size)
+            uint32_t Skip(uint32_t pos, uint8_t classes);
+
+        private:
+            void LoadBlock(uint32_t block_index);
+
+            std::string_view input_;
+            uint32_t block_index_;
+            BlockClasses block_;
+        };
+    } // namespace parser
+} // namespace JIT
+
+#endif // CLASSIFIER_H_
@@ -0,0 +1,258 @@
+#include "parser/parallel_parser.h"
+
+#include <algorithm>
+
+#include "parser/classifier.h"
+
+namespace JIT {
+    namespace parser {
+        // Smaller chunks aren't worth a task
+        constexpr uint32_t MIN_CHUNK_SIZE = 1 << 16;
+        // More tasks than threads even out the load
+        constexpr uint32_t TASKS_PER_THREAD = 4;
+
+        Error ConvertToPostfixNotationSequential(std::string_view input, std::vector<Token>& result) {
+            std::vector<Token> tokens;
+            result.clear();
+            Error error = SplitToTokens(input, tokens);
+            if (error) {
+                return error;
+            }
+            return ConvertToPostfixNotation(input, tokens, result);
+        }
+
+        bool IsOperation(const Token& token, Operation operation) {
+            return token.type == Token::OPERATION && token.operation == operation;
+        }
+
+        // Token after which '+' and '-' are binary (in a correct expression)
+        bool IsOperandEnd(const Token& token) {
+            return token.type == Token::NUMBER || token.type == Token::VARIABLE ||
+                   IsOperation(token, Operation::CLOSE_BRACKET);
+        }
+
+        // Same as in SplitToTokens, for tokens with balanced brackets
+        void CountArguments(std::vector<Token>& tokens) {
+            struct Bracket {
+                Token* function;
+                uint32_t num_commas;
+                bool has_content;
+            };
+
+            std::vector<Bracket> brackets;
+            for (uint32_t i = 0; i < tokens.size(); ++i) {
+                Token& token = tokens[i];
+                bool is_bracket = IsOperation(token, Operation::OPEN_BRACKET) ||
+                                  IsOperation(token, Operation::CLOSE_BRACKET);
+                if (!brackets.empty() && !is_bracket) {
+                    brackets.back().has_content = true;
+                }
+
+                if (token.type == Token::FUNCTION) {
+                    // Function is always followed by its bracket
+                    brackets.push_back({&token, 0, false});
+                    ++i;
+                } else if (IsOperation(token, Operation::OPEN_BRACKET)) {
+                    brackets.push_back({nullptr, 0, false});
+                } else if (IsOperation(token, Operation::COMMA) && !brackets.empty()) {
+                    ++brackets.back().num_commas;
+                } else if (IsOperation(token, Operation::CLOSE_BRACKET) && !brackets.empty()) {
+                    Bracket closed = brackets.back();
+                    brackets.pop_back();
+                    if (closed.function != nullptr) {
+                        closed.function->num_arguments =
+                            closed.num_commas + (closed.has_content ? 1 : 0);
+                    }
+                    if (closed.has_content && !brackets.empty()) {
+                        brackets.back().has_content = true;
+                    }
+                }
+            }
+        }
+
+        // Part of the input split to tokens by a single task
+        struct Chunk {
+            std::vector<Token> tokens;
+            Error error;
+            int64_t depth_change = 0; // Bracket depth at the end relative to the beginning
+            int64_t min_depth = 0; // Relative too
+            int64_t depth = 0; // Bracket depth at the beginning
+            uint32_t first_token = 0; // Index in all tokens
+            const Token* previous = nullptr; // Last token of previous chunks
+            std::vector<uint32_t> splits; // Top level binary '+' and '-'
+        };
+
+        Error ConvertToPostfixNotationParallel(std::string_view input, ThreadPool& pool,
+                                               std::vector<Token>& result) {
+            uint32_t num_tasks = std::min<size_t>(pool.Size() * TASKS_PER_THREAD,
+                                                  input.size() / MIN_CHUNK_SIZE);
+            if (pool.Size() == 1 || num_tasks <= 1) {
+                return ConvertToPostfixNotationSequential(input, result);
+            }
+
+            // Chunk boundaries don't follow a character of a name or a number,
+            // so they never cut a token
+            std::vector<uint32_t> bounds(num_tasks + 1, input.size());
+            bounds[0] = 0;
+            for (uint32_t i = 1; i < num_tasks; ++i) {
+                uint32_t bound = std::max<uint32_t>(bounds[i - 1],
+                                                    static_cast<uint64_t>(input.size()) * i / num_tasks);
+                while (bound > 0 && bound < input.size() &&
+                       (GetCharClass(input[bound - 1]) & (CLASS_ALPHA | CLASS_DIGIT))) {
+                    ++bound;
+                }
+                bounds[i] = bound;
+            }
+
+            std::vector<Chunk> chunks(num_tasks);
+            pool.Run(num_tasks, [&](uint32_t i) {
+                Chunk& chunk = chunks[i];
+                chunk.error = SplitChunkToTokens(input.substr(bounds[i], bounds[i + 1] - bounds[i]),
+                                                 chunk.tokens);
+                for (const Token& token : chunk.tokens) {
+                    if (IsOperation(token, Operation::OPEN_BRACKET)) {
+                        ++chunk.depth_change;
+                    } else if (IsOperation(token, Operation::CLOSE_BRACKET)) {
+                        --chunk.depth_change;
+                        chunk.min_depth = std::min(chunk.min_depth, chunk.depth_change);
+                    }
+                }
+            });
+
+            // Prefix sums over chunks. Unbalanced brackets and other errors are
+            // reported by the sequential parser, so that they are the same
+            int64_t depth = 0;
+            uint32_t num_tokens = 0;
+            const Token* previous = nullptr;
+            for (auto& chunk : chunks) {
+                if (chunk.error || depth + chunk.min_depth < 0) {
+                    return ConvertToPostfixNotationSequential(input, result);
+                }
+                chunk.depth = depth;
+                chunk.first_token = num_tokens;
+                chunk.previous = previous;
+                depth += chunk.depth_change;
+                num_tokens += chunk.tokens.size();
+                if (!chunk.tokens.empty()) {
+                    previous = &chunk.tokens.back();
+                }
+            }
+            if (depth != 0) {
+                return ConvertToPostfixNotationSequential(input, result);
+            }
+
+            pool.Run(num_tasks, [&](uint32_t i) {
+                Chunk& chunk = chunks[i];
+                int64_t depth = chunk.depth;
+                const Token* previous = chunk.previous;
+                for (uint32_t j = 0; j < chunk.tokens.size(); ++j) {
+                    const Token& token = chunk.tokens[j];
+                    if (IsOperation(token, Operation::OPEN_BRACKET)) {
+                        ++depth;
+                    } else if (IsOperation(token, Operation::CLOSE_BRACKET)) {
+                        --depth;
+                    } else if (depth == 0 && previous != nullptr && IsOperandEnd(*previous) &&
+                               (IsOperation(token, Operation::PLUS) ||
+                                IsOperation(token, Operation::MINUS))) {
+                        chunk.splits.push_back(chunk.first_token + j);
+                    }
+                    previous = &token;
+                }
+            });
+
+            // Parts are separated by the first top level '+' or '-' after an even
+            // share of tokens
+            std::vector<uint32_t> separators;
+            uint32_t chunk_index = 0;
+            for (uint32_t i = 1; i < num_tasks; ++i) {
+                uint32_t target = static_cast<uint64_t>(num_tokens) * i / num_tasks;
+                if (!separators.empty()) {
+                    target = std::max(target, separators.back() + 1);
+                }
+                while (chunk_index < num_tasks &&
+                       (chunk_index + 1 < num_tasks ? chunks[chunk_index + 1].first_token : num_tokens) <= target) {
+                    ++chunk_index;
+                }
+                for (uint32_t j = chunk_index; j < num_tasks; ++j) {
+                    const auto& splits = chunks[j].splits;
+                    auto split = std::lower_bound(splits.begin(), splits.end(), target);
+                    if (split != splits.end()) {
+                        separators.push_back(*split);
+                        break;
+                    }
+                }
+                if (separators.empty() || separators.back() < target) {
+                    // No more splits
+                    break;
+                }
+            }
+
+            // Tokens stay in chunks, index is the same as in the whole list
+            auto chunk_of = [&chunks](uint32_t index) {
+                return std::upper_bound(chunks.begin(), chunks.end(), index,
+                                        [](uint32_t index, const Chunk& chunk) {
+                                            return index < chunk.first_token;
+                                        }) - 1;
+            };
+            auto token_at = [&chunk_of](uint32_t index) {
+                auto chunk = chunk_of(index);
+                return chunk->tokens[index - chunk->first_token];
+            };
+            auto append_tokens = [&chunk_of](uint32_t begin, uint32_t end, std::vector<Token>& out) {
+                for (auto chunk = chunk_of(begin); begin < end; ++chunk) {
+                    uint32_t chunk_end = std::min<uint32_t>(end, chunk->first_token + chunk->tokens.size());
+                    out.insert(out.end(), chunk->tokens.begin() + (begin - chunk->first_token),
+                               chunk->tokens.begin() + (chunk_end - chunk->first_token));
+                    begin = chunk_end;
+                }
+            };
+
+            uint32_t num_parts = separators.size() + 1;
+            std::vector<std::vector<Token>> parts(num_parts);
+            std::vector<Error> errors(num_parts);
+            pool.Run(num_parts, [&](uint32_t i) {
+                std::vector<Token> part;
+                if (i > 0) {
+                    // These operations are the lowest priority ones and left associative,
+                    // so the notation of "0 <separator> <part>" without the leading zero
+                    // continues the notation of the previous parts
+                    Token zero;
+                    zero.type = Token::NUMBER;
+                    zero.number = 0;
+                    zero.text = token_at(separators[i - 1]).text;
+                    part.push_back(zero);
+                    part.push_back(token_at(separators[i - 1]));
+                }
+                uint32_t begin = (i == 0 ? 0 : separators[i - 1] + 1);
+                uint32_t end = (i + 1 < num_parts ? separators[i] : num_tokens);
+                append_tokens(begin, end, part);
+                CountArguments(part);
+                errors[i] = ConvertToPostfixNotation(input, part, parts[i]);
+            });
+            for (const auto& error : errors) {
+                if (error) {
+                    return ConvertToPostfixNotationSequential(input, result);
+                }
+            }
+
+            std::vector<uint32_t> offsets(num_parts + 1, 0);
+            for (uint32_t i = 0; i < num_parts; ++i) {
+                offsets[i + 1] = offsets[i] + parts[i].size() - (i > 0 ? 1 : 0);
+            }
+            result.resize(offsets[num_parts]);
+            pool.Run(num_parts, [&](uint32_t i) {
+                std::copy(parts[i].begin() + (i > 0 ? 1 : 0), parts[i].end(), result.begin() + offsets[i]);
+            });
+            return {};
+        }
+
+        std::vector<Token> ConvertToPostfixNotationParallel(std::string_view input, ThreadPool& pool) {
+            std::vector<Token> result;
+            Error error = ConvertToPostfixNotationParallel(input, pool, result);
+            if (error) {
+                ThrowError(error, input);
+            }
+            return result;
+        }
+    } // namespace parser
+} // namespace JIT
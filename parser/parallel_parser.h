@@ -0,0 +1,25 @@
+#ifndef PARALLEL_PARSER_H_
+#define PARALLEL_PARSER_H_
+
+#include <string_view>
+#include <vector>
+
+#include "parser/parser.h"
+#include "parser/thread_pool.h"
+
+namespace JIT {
+    namespace parser {
+        // Front end for multi-megabyte expressions: chunks of the input are split to
+        // tokens concurrently, then the expression is cut at top level '+' and '-'
+        // to parts converted concurrently. Gives the same postfix notation (and
+        // errors) as SplitToTokens followed by ConvertToPostfixNotation. Short
+        // inputs are parsed sequentially
+        std::vector<Token> ConvertToPostfixNotationParallel(std::string_view input, ThreadPool& pool);
+
+        // Same without exceptions
+        Error ConvertToPostfixNotationParallel(std::string_view input, ThreadPool& pool,
+                                               std::vector<Token>& result);
+    } // namespace parser
+} // namespace JIT
+
+#endif // PARALLEL_PARSER_H_
@@ -1,7 +1,10 @@
 #include "parser/parser.h"
 
+#include "parser/classifier.h"
+
 #include <cctype>
 #include <stack>
+#include <string>
 
 namespace JIT {
     namespace parser {
@@ -29,91 +32,162 @@ namespace JIT {
             return err_msg;
         }
 
-        std::vector<Token> SplitToTokens(const std::string& input) {
+        void ThrowError(const Error& error, std::string_view input) {
+            switch (error.kind) {
+            case ErrorKind::MISSING_OPERATOR:
+                throw missing_operator();
+
+            case ErrorKind::MISSING_OPERAND:
+                throw missing_operand();
+
+            case ErrorKind::MISSING_OPEN_BRACKET:
+                throw missing_open_bracket();
+
+            case ErrorKind::MISSING_CLOSE_BRACKET:
+                throw missing_close_bracket();
+
+            case ErrorKind::UNKNOWN_SYMBOL:
+                throw unknown_symbol(input[error.position]);
+
+            case ErrorKind::UNDEFINED_SYMBOL: {
+                uint32_t name_size = 0;
+                while (error.position + name_size < input.size() &&
+                       isalnum(input[error.position + name_size])) {
+                    ++name_size;
+                }
+                throw std::out_of_range("Undefined symbol " +
+                                        std::string(input.substr(error.position, name_size)));
+            }
+
+            default:
+                break;
+            }
+        }
+
+        // Without COUNT_ARGUMENTS brackets aren't tracked at all, so the input
+        // may be any part of an expression cut at token boundaries
+        template <bool COUNT_ARGUMENTS>
+        Error SplitToTokens(std::string_view input, std::vector<Token>& result) {
+            // Bracket opened during tokenization: owning function (if any),
+            // number of commas inside and presence of any operand
+            struct Bracket {
+                int64_t function_index;
+                uint32_t position;
+                uint32_t num_commas;
+                bool has_content;
+            };
+
             uint32_t pos = 0;
-            std::vector<Token> result;
+            std::vector<Bracket> brackets;
+            // Token boundaries are found by character class masks
+            Classifier classifier(input);
 
             while (pos < input.size()) {
-                // Skip spaces
-                while (pos < input.size() && isspace(input[pos])) {
-                    ++pos;
-                }
+                pos = classifier.Skip(pos, CLASS_SPACE);
                 if (pos >= input.size()) {
                     break;
                 }
+                uint8_t symbol_class = GetCharClass(input[pos]);
+                if (COUNT_ARGUMENTS && !brackets.empty() && input[pos] != '(' && input[pos] != ')') {
+                    brackets.back().has_content = true;
+                }
 
                 // Symbol name
-                if (isalpha(input[pos])) {
-                    uint32_t name_size = 0;
-                    while (pos + name_size < input.size() &&
-                      (isalpha(input[pos + name_size]) || isdigit(input[pos + name_size]))) {
-                        ++name_size;
-                    }
-                    std::string name = input.substr(pos, name_size);
+                if (symbol_class == CLASS_ALPHA) {
+                    uint32_t name_size = classifier.Skip(pos, CLASS_ALPHA | CLASS_DIGIT) - pos;
+                    std::string_view name = input.substr(pos, name_size);
                     pos += name_size;
                     if (pos >= input.size() || input[pos] != '(') {
                         // Variable
                         Token tok;
                         tok.type = Token::VARIABLE;
-                        tok.variable.name = name;
+                        tok.text = name;
                         result.push_back(tok);
                     } else {
-                        // Function
-                        // Count number of arguments
-                        uint32_t scan_pos = pos + 1, depth = 1;
-                        uint32_t num_arguments = 0;
-                        uint32_t additional_content = 0; 
-                        while (depth > 0 && scan_pos < input.size()) {
-                            if (input[scan_pos] == '(') {
-                                ++depth;
-                            } else if (input[scan_pos] == ')') {
-                                --depth;
-                            } else {
-                                if (input[scan_pos] == ',' && depth == 1) {
-                                    ++num_arguments;
-                                }
-                                ++additional_content;
-                            }
-                            ++scan_pos;
-                        }
-                        if (depth > 0) {
-                            throw missing_close_bracket();
-                        }
-                        if (additional_content > 0) {
-                            ++num_arguments;
-                        }
-
+                        // Function, number of arguments is set on its close bracket
                         Token tok;
                         tok.type = Token::FUNCTION;
-                        tok.function.name = name;
-                        tok.function.num_arguments = num_arguments;
+                        tok.text = name;
+                        tok.num_arguments = 0;
                         result.push_back(tok);
+                        if (COUNT_ARGUMENTS) {
+                            brackets.push_back({static_cast<int64_t>(result.size()) - 1, pos, 0, false});
+                        }
+                        // Bracket itself is added below
+                        Token bracket;
+                        bracket.type = Token::OPERATION;
+                        bracket.operation = Operation::OPEN_BRACKET;
+                        bracket.text = input.substr(pos, 1);
+                        result.push_back(bracket);
+                        ++pos;
                     }
-                } else if (isdigit(input[pos])) {
+                } else if (symbol_class == CLASS_DIGIT) {
                     // Number
-                    uint32_t number_size = 0;
-                    while (pos + number_size < input.size() && isdigit(input[pos + number_size])) {
-                        ++number_size;
+                    uint32_t number_size = classifier.Skip(pos, CLASS_DIGIT) - pos;
+                    // Literals wrap around like the 32-bit arithmetic they are used in
+                    uint32_t number = 0;
+                    for (uint32_t i = 0; i < number_size; ++i) {
+                        number = number * 10 + (input[pos + i] - '0');
                     }
-                    int32_t number = std::atoi(input.substr(pos, number_size).c_str());
-                    pos += number_size;
                     Token tok;
                     tok.type = Token::NUMBER;
-                    tok.number = number;
+                    tok.number = static_cast<int32_t>(number);
+                    tok.text = input.substr(pos, number_size);
+                    pos += number_size;
                     result.push_back(tok); 
                 } else {
-                    if (input[pos] != '+' && input[pos] != '-' && input[pos] != '*' &&
-                        input[pos] != '(' && input[pos] != ')' && input[pos] != ',') {
-                        throw unknown_symbol(input[pos]);
+                    if (symbol_class != CLASS_OPERATION) {
+                        return {ErrorKind::UNKNOWN_SYMBOL, pos};
+                    }
+
+                    if (!COUNT_ARGUMENTS) {
+                        // Brackets are matched by the caller
+                    } else if (input[pos] == '(') {
+                        brackets.push_back({-1, pos, 0, false});
+                    } else if (input[pos] == ',' && !brackets.empty()) {
+                        ++brackets.back().num_commas;
+                    } else if (input[pos] == ')' && !brackets.empty()) {
+                        Bracket closed = brackets.back();
+                        brackets.pop_back();
+                        if (closed.function_index >= 0) {
+                            result[closed.function_index].num_arguments =
+                                closed.num_commas + (closed.has_content ? 1 : 0);
+                        }
+                        if (closed.has_content && !brackets.empty()) {
+                            brackets.back().has_content = true;
+                        }
                     }
 
                     Token tok;
                     tok.type = Token::OPERATION;
                     tok.operation = static_cast<Operation>(input[pos]);
+                    tok.text = input.substr(pos, 1);
                     result.push_back(tok);
                     ++pos;
                 }
             }
+            for (const auto& bracket : brackets) {
+                if (bracket.function_index >= 0) {
+                    return {ErrorKind::MISSING_CLOSE_BRACKET, bracket.position};
+                }
+            }
+            return {};
+        }
+
+        Error SplitToTokens(std::string_view input, std::vector<Token>& result) {
+            return SplitToTokens<true>(input, result);
+        }
+
+        Error SplitChunkToTokens(std::string_view chunk, std::vector<Token>& result) {
+            return SplitToTokens<false>(chunk, result);
+        }
+
+        std::vector<Token> SplitToTokens(std::string_view input) {
+            std::vector<Token> result;
+            Error error = SplitToTokens(input, result);
+            if (error) {
+                ThrowError(error, input);
+            }
             return result;
         }
 
@@ -141,7 +215,9 @@ namespace JIT {
             }
         }
 
-        void DropOperators(std::vector<Token>& result, std::stack<Token>& operators, Operation oper) {
+        template <class Output>
+        void DropOperators(Output& result, std::stack<Token, std::vector<Token>>& operators,
+                           Operation oper) {
             while (!operators.empty()) {
                 if (GetPriority(operators.top().operation) >= GetPriority(oper)) {
                     result.push_back(operators.top());
@@ -152,23 +228,47 @@ namespace JIT {
             }
         }
 
-        std::vector<Token> ConvertToPostfixNotation(const std::vector<Token>& input) {
+        // Shunting-yard algorithm: tokens are passed to result.push_back in postfix order.
+        // Tokens should be split from source, which is used for error positions only
+        template <class Output>
+        Error ConvertToPostfixNotation(std::string_view source, const std::vector<Token>& input,
+                                       Output& result) {
             enum State {
                 WAIT_OPERATOR,
                 WAIT_OPERAND
             } state = WAIT_OPERAND;
-            std::vector<Token> result;
-            std::stack<Token> operators;
-            
-            for (auto token : input) {
+            std::stack<Token, std::vector<Token>> operators;
+            auto position = [&source](const Token& token) -> uint32_t {
+                return source.empty() ? 0 : token.text.data() - source.data();
+            };
+            auto is_call_bracket = [&operators]() {
+                // Open bracket on the top is preceded by function symbol
+                Token bracket = operators.top();
+                operators.pop();
+                bool result = !operators.empty() && operators.top().type == Token::FUNCTION;
+                operators.push(bracket);
+                return result;
+            };
+
+            for (uint32_t i = 0; i < input.size(); ++i) {
+                Token token = input[i];
+                bool after_open_bracket = (i > 0 && input[i - 1].type == Token::OPERATION &&
+                                           input[i - 1].operation == Operation::OPEN_BRACKET);
                 if (state == WAIT_OPERAND) {
                     if (token.type == Token::OPERATION) {
                         // Bracket or unary minus
                         if (token.operation == Operation::MINUS) {
                             token.operation = Operation::UNARY_MINUS;
-                        } else if (token.operation != Operation::OPEN_BRACKET &&
-                                   token.operation != Operation::CLOSE_BRACKET) {
-                            throw missing_operand();
+                        } else if (token.operation == Operation::CLOSE_BRACKET &&
+                                   after_open_bracket && is_call_bracket()) {
+                            // Call without arguments
+                            operators.pop();
+                            result.push_back(operators.top());
+                            operators.pop();
+                            state = WAIT_OPERATOR;
+                            continue;
+                        } else if (token.operation != Operation::OPEN_BRACKET) {
+                            return {ErrorKind::MISSING_OPERAND, position(token)};
                         }
                         operators.push(token);
                     } else if (token.type == Token::FUNCTION) {
@@ -179,8 +279,9 @@ namespace JIT {
                         state = WAIT_OPERATOR;
                     }
                 } else {
-                    if (token.type != Token::OPERATION) {
-                        throw missing_operator();
+                    if (token.type != Token::OPERATION ||
+                        token.operation == Operation::OPEN_BRACKET) {
+                        return {ErrorKind::MISSING_OPERATOR, position(token)};
                     }
                     DropOperators(result, operators, token.operation);
                     if (token.operation == Operation::CLOSE_BRACKET) {
@@ -188,7 +289,7 @@ namespace JIT {
                         if (operators.empty() ||
                             operators.top().type != Token::OPERATION ||
                             operators.top().operation != Operation::OPEN_BRACKET) {
-                            throw missing_open_bracket();
+                            return {ErrorKind::MISSING_OPEN_BRACKET, position(token)};
                         }
                         operators.pop();
                         // Move function symbol (if it exists)
@@ -200,15 +301,90 @@ namespace JIT {
                     }
                     if (token.operation != Operation::COMMA) {
                         operators.push(token);
+                    } else if (operators.empty() || !is_call_bracket()) {
+                        // Arguments are separated outside of a call
+                        return {ErrorKind::MISSING_OPERATOR, position(token)};
                     }
                     state = WAIT_OPERAND;
                 }
             }
+            if (state == WAIT_OPERAND) {
+                return {ErrorKind::MISSING_OPERAND, static_cast<uint32_t>(source.size())};
+            }
             DropOperators(result, operators, Operation::CLOSE_BRACKET);
             if (!operators.empty()) {
-                throw missing_close_bracket();
+                return {ErrorKind::MISSING_CLOSE_BRACKET, position(operators.top())};
+            }
+            return {};
+        }
+
+        Error ConvertToPostfixNotation(std::string_view source, const std::vector<Token>& input,
+                                       std::vector<Token>& result) {
+            return ConvertToPostfixNotation<std::vector<Token>>(source, input, result);
+        }
+
+        std::vector<Token> ConvertToPostfixNotation(const std::vector<Token>& input) {
+            std::vector<Token> result;
+            Error error = ConvertToPostfixNotation(std::string_view(), input, result);
+            if (error) {
+                ThrowError(error, std::string_view());
             }
             return result;
         }
+
+        // Reduces postfix notation to the tree on the fly
+        class ExpressionTreeBuilder {
+        public:
+            ExpressionTreeBuilder(ExpressionTree& tree) : tree_(tree) {
+            }
+
+            void push_back(const Token& token) {
+                uint32_t num_children = 0;
+                if (token.type == Token::FUNCTION) {
+                    num_children = token.num_arguments;
+                } else if (token.type == Token::OPERATION) {
+                    num_children = (token.operation == Operation::UNARY_MINUS ? 1 : 2);
+                }
+                if (operands_.size() < num_children) {
+                    throw missing_operand();
+                }
+
+                tree_.types.push_back(token.type);
+                tree_.operations.push_back(token.operation);
+                tree_.numbers.push_back(token.type == Token::NUMBER ? token.number : 0);
+                tree_.names.push_back(token.text);
+                tree_.first_children.push_back(tree_.children.size());
+                tree_.num_children.push_back(num_children);
+                tree_.children.insert(tree_.children.end(),
+                                      operands_.end() - num_children, operands_.end());
+                operands_.resize(operands_.size() - num_children);
+                operands_.push_back(tree_.Size() - 1);
+            }
+
+            void Finish() {
+                if (operands_.empty()) {
+                    throw missing_operand();
+                }
+                if (operands_.size() > 1) {
+                    throw missing_operator();
+                }
+            }
+
+        private:
+            ExpressionTree& tree_;
+            std::vector<ExpressionTree::NodeIndex> operands_;
+        };
+
+        ExpressionTree ConvertToExpressionTree(const std::vector<Token>& input) {
+            ExpressionTree tree;
+            ExpressionTreeBuilder builder(tree);
+            Error error = ConvertToPostfixNotation(std::string_view(), input, builder);
+            if (error) {
+                ThrowError(error, std::string_view());
+            }
+            builder.Finish();
+            return tree;
+        }
+
     } // namespace parser
 } // namespace JIT
\ No newline at end of file
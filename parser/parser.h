@@ -3,7 +3,7 @@
 
 #include <cstdint>
 #include <stdexcept>
-#include <string>
+#include <string_view>
 #include <vector>
 
 namespace JIT {
@@ -37,16 +37,7 @@ namespace JIT {
             char err_msg[19] = "Unknown symbol ' '";
         };
 
-        struct Variable {
-            std::string name;
-        };
-
-        struct Function {
-            std::string name;
-            uint32_t num_arguments;
-        };
-
-        enum struct Operation {
+        enum struct Operation : char {
             PLUS = '+',
             MINUS = '-',
             MULTIPLY = '*',
@@ -56,21 +47,87 @@ namespace JIT {
             COMMA = ','
         };
 
+        // Error channel for callers that can't afford exceptions
+        enum struct ErrorKind : uint8_t {
+            NONE,
+            MISSING_OPERATOR,
+            MISSING_OPERAND,
+            MISSING_OPEN_BRACKET,
+            MISSING_CLOSE_BRACKET,
+            UNKNOWN_SYMBOL,
+            UNDEFINED_SYMBOL // Name is missing in externs
+        };
+
+        struct Error {
+            ErrorKind kind = ErrorKind::NONE;
+            uint32_t position = 0; // Byte offset in the expression
+
+            explicit operator bool() const {
+                return kind != ErrorKind::NONE;
+            }
+        };
+
+        // Throws exception matching the error, input is the erroneous expression
+        void ThrowError(const Error& error, std::string_view input);
+
+        // Tokens don't own their text: it is a view into the parsed expression,
+        // so the expression should outlive them
         struct Token {
-            enum Type {
+            enum Type : uint8_t {
                 VARIABLE,
                 FUNCTION,
                 NUMBER,
                 OPERATION
             } type;
-            Variable variable;
-            Function function;
-            int32_t number;
             Operation operation;
+            union {
+                int32_t number;
+                uint32_t num_arguments; // For functions
+            };
+            std::string_view text; // Symbol name for variables and functions
         };
 
-        std::vector<Token> SplitToTokens(const std::string& input);
+        static_assert(sizeof(Token) <= 8 + sizeof(std::string_view), "Token should stay compact");
+
+        // Expression tree as a flat arena in struct-of-arrays layout. Nodes are
+        // stored in postfix order, so children always precede their parent and
+        // the root is the last node
+        struct ExpressionTree {
+            using NodeIndex = uint32_t;
+
+            std::vector<Token::Type> types;
+            std::vector<Operation> operations;
+            std::vector<int32_t> numbers;
+            std::vector<std::string_view> names;
+            std::vector<uint32_t> first_children; // Position in children
+            std::vector<uint32_t> num_children;
+            std::vector<NodeIndex> children;
+
+            uint32_t Size() const {
+                return types.size();
+            }
+
+            NodeIndex Root() const {
+                return Size() - 1;
+            }
+
+            NodeIndex Child(NodeIndex node, uint32_t child_number) const {
+                return children[first_children[node] + child_number];
+            }
+        };
+
+        std::vector<Token> SplitToTokens(std::string_view input);
         std::vector<Token> ConvertToPostfixNotation(const std::vector<Token>& input);
+
+        // Same without exceptions. Tokens should be split from source
+        Error SplitToTokens(std::string_view input, std::vector<Token>& result);
+        Error ConvertToPostfixNotation(std::string_view source, const std::vector<Token>& input,
+                                       std::vector<Token>& result);
+        ExpressionTree ConvertToExpressionTree(const std::vector<Token>& input);
+
+        // Tokens of a part of an expression cut at token boundaries: brackets may be
+        // unbalanced and functions have zero number of arguments
+        Error SplitChunkToTokens(std::string_view chunk, std::vector<Token>& result);
     } // namespace parser
 } // namespace JIT
 
@@ -0,0 +1,68 @@
+#include "parser/thread_pool.h"
+
+namespace JIT {
+    namespace parser {
+        ThreadPool::ThreadPool(uint32_t num_threads) {
+            if (num_threads == 0) {
+                num_threads = std::thread::hardware_concurrency();
+            }
+            for (uint32_t i = 1; i < num_threads; ++i) {
+                workers_.emplace_back(&ThreadPool::Work, this);
+            }
+        }
+
+        ThreadPool::~ThreadPool() {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                stopped_ = true;
+            }
+            started_.notify_all();
+            for (auto& worker : workers_) {
+                worker.join();
+            }
+        }
+
+        uint32_t ThreadPool::Size() const {
+            return workers_.size() + 1;
+        }
+
+        void ThreadPool::Run(uint32_t num_tasks, const std::function<void(uint32_t)>& task) {
+            std::unique_lock<std::mutex> lock(mutex_);
+            task_ = &task;
+            num_tasks_ = num_tasks;
+            next_task_ = 0;
+            num_finished_ = 0;
+            ++run_index_;
+            started_.notify_all();
+            RunTasks(lock);
+            finished_.wait(lock, [this]() { return num_finished_ == num_tasks_; });
+            task_ = nullptr;
+        }
+
+        void ThreadPool::Work() {
+            std::unique_lock<std::mutex> lock(mutex_);
+            uint64_t last_run = 0;
+            while (true) {
+                started_.wait(lock, [&]() { return stopped_ || run_index_ != last_run; });
+                if (stopped_) {
+                    return;
+                }
+                last_run = run_index_;
+                RunTasks(lock);
+            }
+        }
+
+        void ThreadPool::RunTasks(std::unique_lock<std::mutex>& lock) {
+            while (next_task_ < num_tasks_) {
+                uint32_t task_index = next_task_++;
+                const auto& task = *task_;
+                lock.unlock();
+                task(task_index);
+                lock.lock();
+                if (++num_finished_ == num_tasks_) {
+                    finished_.notify_all();
+                }
+            }
+        }
+    } // namespace parser
+} // namespace JIT
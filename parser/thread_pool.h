@@ -0,0 +1,51 @@
+#ifndef THREAD_POOL_H_
+#define THREAD_POOL_H_
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace JIT {
+    namespace parser {
+        // Fixed set of threads for data parallel loops
+        class ThreadPool {
+        public:
+            // Zero means one thread per core. The calling thread takes part in
+            // the work, so one less thread is started
+            explicit ThreadPool(uint32_t num_threads = 0);
+            ~ThreadPool();
+
+            ThreadPool(const ThreadPool&) = delete;
+            ThreadPool& operator=(const ThreadPool&) = delete;
+
+            // Number of threads doing the work including the calling one
+            uint32_t Size() const;
+
+            // Calls task(i) for every i in [0, num_tasks) and waits for all of them.
+            // Tasks shouldn't throw
+            void Run(uint32_t num_tasks, const std::function<void(uint32_t)>& task);
+
+        private:
+            void Work();
+            // Takes tasks of the current run until they are over, lock is held
+            // outside of the tasks
+            void RunTasks(std::unique_lock<std::mutex>& lock);
+
+            std::vector<std::thread> workers_;
+            std::mutex mutex_;
+            std::condition_variable started_;
+            std::condition_variable finished_;
+            const std::function<void(uint32_t)>* task_ = nullptr;
+            uint32_t num_tasks_ = 0;
+            uint32_t next_task_ = 0;
+            uint32_t num_finished_ = 0;
+            uint64_t run_index_ = 0;
+            bool stopped_ = false;
+        };
+    } // namespace parser
+} // namespace JIT
+
+#endif // THREAD_POOL_H_
@@ -0,0 +1,101 @@
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "parser/parallel_parser.h"
+#include "translator/fast_compiler.h"
+#include "translator/optimizing_compiler.h"
+#include "translator/translator.h"
+
+typedef int (*compiler_t)(const char*, const symbol_t*, void*);
+
+int32_t a = 0, b = 1, c = 2, d = 239;
+
+int32_t sum(int32_t a, int32_t b, int32_t c) {
+    return a + b + c;
+}
+
+int32_t dec(int32_t a) {
+    return a - 1;
+}
+
+symbol_t symbols[] =
+{
+    {"a", &a},
+    {"b", &b},
+    {"c", &c},
+    {"d", &d},
+    {"sum", reinterpret_cast<void*>(sum)},
+    {"dec", reinterpret_cast<void*>(dec)},
+    {nullptr, nullptr}
+};
+
+const char* expressions[] = {
+    "1",
+    "a+b",
+    "a*b+3",
+    "sum(2+3*dec(d), a)-(-c)",
+    "(a+b)*(c-d)*-(a*b*c*d+1)-dec(dec(dec(a)))",
+};
+
+constexpr uint32_t NUM_ITERATIONS = 20000;
+
+// Average compile time in nanoseconds
+double MeasureCompileTime(compiler_t compiler, const char* expression, void* buffer) {
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < NUM_ITERATIONS; ++i) {
+        compiler(expression, symbols, buffer);
+    }
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / NUM_ITERATIONS;
+}
+
+int CompileInArena(const char* expression, const symbol_t* externs, void* out_buffer) {
+    char scratch[256];
+    return jit_compile_expression_to_arm_in_arena(expression, externs, out_buffer,
+                                                  scratch, sizeof(scratch));
+}
+
+// Parse throughput in megabytes per second
+template <class Parse>
+double MeasureParseThroughput(const std::string& expression, Parse parse) {
+    auto start = std::chrono::steady_clock::now();
+    parse(expression);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return expression.size() / elapsed.count() / (1 << 20);
+}
+
+int CompileOptimized(const char* expression, const symbol_t* externs, void* out_buffer) {
+    jit_options_t options = {2, nullptr, 0, 0, 0, nullptr, 0, 0};
+    return jit_compile_expression_to_arm_with_options(expression, externs, out_buffer, &options, nullptr);
+}
+
+int main() {
+    std::vector<uint32_t> buffer(1024);
+
+    printf("%-45s %12s %12s %12s %12s\n", "Expression", "Default, ns", "Fast, ns", "Arena, ns", "O2, ns");
+    for (const char* expression : expressions) {
+        printf("%-45s %12.0f %12.0f %12.0f %12.0f\n", expression,
+               MeasureCompileTime(jit_compile_expression_to_arm, expression, buffer.data()),
+               MeasureCompileTime(jit_compile_expression_to_arm_fast, expression, buffer.data()),
+               MeasureCompileTime(CompileInArena, expression, buffer.data()),
+               MeasureCompileTime(CompileOptimized, expression, buffer.data()));
+    }
+
+    std::string large_expression = expressions[3];
+    while (large_expression.size() < (8 << 20)) {
+        large_expression += std::string("-") + expressions[3];
+    }
+    JIT::parser::ThreadPool pool;
+    printf("\nParsing %zu MB: sequential %.1f MB/s, %u threads %.1f MB/s\n",
+           large_expression.size() >> 20,
+           MeasureParseThroughput(large_expression, [](const std::string& expression) {
+               JIT::parser::ConvertToPostfixNotation(JIT::parser::SplitToTokens(expression));
+           }),
+           pool.Size(),
+           MeasureParseThroughput(large_expression, [&pool](const std::string& expression) {
+               JIT::parser::ConvertToPostfixNotationParallel(expression, pool);
+           }));
+    return 0;
+}
@@ -1,10 +1,45 @@
+#include <algorithm>
+#include <atomic>
 #include <sys/mman.h>
 
 #include "gtest/gtest.h"
 
+#include "parser/classifier.h"
+#include "parser/parallel_parser.h"
+
+#include "optimizer/passes.h"
+
+#include "translator/commands.h"
+#include "translator/fast_compiler.h"
+#include "translator/optimizing_compiler.h"
+#include "translator/peephole.h"
+#include "translator/static_compiler.h"
+#include "translator/strength_reduction.h"
 #include "translator/translator.h"
 
 typedef int (*function_t)();
+typedef int (*compiler_t)(const char*, const symbol_t*, void*);
+
+// Count heap allocations to check allocation-free compilation. Atomic as the
+// parallel parser allocates from several threads
+static std::atomic<uint32_t> num_allocations(0);
+
+void* operator new(size_t size) {
+    ++num_allocations;
+    void* result = malloc(size);
+    if (result == nullptr) {
+        throw std::bad_alloc();
+    }
+    return result;
+}
+
+void operator delete(void* pointer) noexcept {
+    free(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept {
+    free(pointer);
+}
 
 TEST(TokenSplitter, NumberParse) {
     auto first_expr = JIT::parser::SplitToTokens("1");
@@ -28,13 +63,26 @@ TEST(TokenSplitter, FunctionParse) {
     auto first_expr = JIT::parser::SplitToTokens("f()");
     EXPECT_GT(first_expr.size(), 1);
     EXPECT_EQ(first_expr[0].type, JIT::parser::Token::FUNCTION);
-    EXPECT_EQ(first_expr[0].function.name, "f");
-    EXPECT_EQ(first_expr[0].function.num_arguments, 0);
+    EXPECT_EQ(first_expr[0].text, "f");
+    EXPECT_EQ(first_expr[0].num_arguments, 0);
     auto second_expr = JIT::parser::SplitToTokens("f(1, 2)");
     EXPECT_GT(second_expr.size(), 1);
     EXPECT_EQ(second_expr[0].type, JIT::parser::Token::FUNCTION);
-    EXPECT_EQ(second_expr[0].function.name, "f");
-    EXPECT_EQ(second_expr[0].function.num_arguments, 2);
+    EXPECT_EQ(second_expr[0].text, "f");
+    EXPECT_EQ(second_expr[0].num_arguments, 2);
+}
+
+TEST(TokenSplitter, NestedFunctionParse) {
+    auto expr = JIT::parser::SplitToTokens("f(g(1, (2, 3)), h(), 4)");
+    EXPECT_EQ(expr[0].type, JIT::parser::Token::FUNCTION);
+    EXPECT_EQ(expr[0].text, "f");
+    EXPECT_EQ(expr[0].num_arguments, 3);
+    EXPECT_EQ(expr[2].type, JIT::parser::Token::FUNCTION);
+    EXPECT_EQ(expr[2].text, "g");
+    EXPECT_EQ(expr[2].num_arguments, 2);
+    EXPECT_EQ(expr[13].type, JIT::parser::Token::FUNCTION);
+    EXPECT_EQ(expr[13].text, "h");
+    EXPECT_EQ(expr[13].num_arguments, 0);
 }
 
 TEST(TokenSplitter, Trash) {
@@ -42,6 +90,35 @@ TEST(TokenSplitter, Trash) {
     EXPECT_ANY_THROW(JIT::parser::SplitToTokens("+@"));
 }
 
+TEST(TokenSplitter, LongTokens) {
+    std::string name(100, 'x');
+    std::string number(40, '1');
+    std::string expr = name + std::string(70, ' ') + "+" + number + "*" + name + "1";
+    auto tokens = JIT::parser::SplitToTokens(expr);
+    EXPECT_EQ(tokens.size(), 5);
+    EXPECT_EQ(tokens[0].text, name);
+    EXPECT_EQ(tokens[2].text, number);
+    EXPECT_EQ(tokens[4].text, name + "1");
+}
+
+TEST(Classifier, MatchesCharacterFunctions) {
+    for (uint32_t first = 0; first < 256; first += JIT::parser::BLOCK_SIZE) {
+        char block[JIT::parser::BLOCK_SIZE];
+        for (uint32_t i = 0; i < JIT::parser::BLOCK_SIZE; ++i) {
+            block[i] = static_cast<char>(first + i);
+        }
+        auto classes = JIT::parser::ClassifyBlock(block);
+        for (uint32_t i = 0; i < JIT::parser::BLOCK_SIZE; ++i) {
+            int symbol = first + i;
+            bool is_operation = symbol != 0 && strchr("+-*(),", symbol) != nullptr;
+            EXPECT_EQ((classes.space >> i) & 1, isspace(symbol) != 0) << symbol;
+            EXPECT_EQ((classes.alpha >> i) & 1, isalpha(symbol) != 0) << symbol;
+            EXPECT_EQ((classes.digit >> i) & 1, isdigit(symbol) != 0) << symbol;
+            EXPECT_EQ((classes.operation >> i) & 1, is_operation) << symbol;
+        }
+    }
+}
+
 TEST(Parser, SimpleOperations) {
     auto splitted = JIT::parser::SplitToTokens("1+2*3");
     auto postfix = JIT::parser::ConvertToPostfixNotation(splitted);
@@ -97,8 +174,8 @@ TEST(Parser, Functions) {
     EXPECT_EQ(postfix[3].type, JIT::parser::Token::NUMBER);
     EXPECT_EQ(postfix[3].number, 3);
     EXPECT_EQ(postfix[4].type, JIT::parser::Token::FUNCTION);
-    EXPECT_EQ(postfix[4].function.name, "f");
-    EXPECT_EQ(postfix[4].function.num_arguments, 2);
+    EXPECT_EQ(postfix[4].text, "f");
+    EXPECT_EQ(postfix[4].num_arguments, 2);
 }
 
 TEST(Parser, MissingBrackets) {
@@ -110,7 +187,7 @@ TEST(Parser, MissingBrackets) {
 }
 
 TEST(Parser, MissingOperator) {
-    std::string incorrect_samples[] = {"1+2 3", "f(a 1, 2)"};
+    std::string incorrect_samples[] = {"1+2 3", "f(a 1, 2)", "(1, 2)", "f(1)(2)"};
 
     for (const auto& sample : incorrect_samples) {
         EXPECT_ANY_THROW(JIT::parser::ConvertToPostfixNotation(JIT::parser::SplitToTokens(sample)));
@@ -118,13 +195,117 @@ TEST(Parser, MissingOperator) {
 }
 
 TEST(Parser, MissingOperand) {
-    std::string incorrect_samples[] = {"1+*3", "f(a-, 2)"};
+    std::string incorrect_samples[] = {"1+*3", "f(a-, 2)", "1+", "f(1,)", "()"};
 
     for (const auto& sample : incorrect_samples) {
         EXPECT_ANY_THROW(JIT::parser::ConvertToPostfixNotation(JIT::parser::SplitToTokens(sample)));
     }
 }
 
+TEST(Parser, CallWithoutArguments) {
+    auto splitted = JIT::parser::SplitToTokens("f()+1");
+    auto postfix = JIT::parser::ConvertToPostfixNotation(splitted);
+
+    EXPECT_EQ(postfix.size(), 3);
+    EXPECT_EQ(postfix[0].type, JIT::parser::Token::FUNCTION);
+    EXPECT_EQ(postfix[0].num_arguments, 0);
+    EXPECT_EQ(postfix[2].operation, JIT::parser::Operation::PLUS);
+}
+
+TEST(ExpressionTree, Structure) {
+    auto tree = JIT::parser::ConvertToExpressionTree(JIT::parser::SplitToTokens("f(1+2,a)*-3"));
+
+    EXPECT_EQ(tree.Size(), 8);
+    auto root = tree.Root();
+    EXPECT_EQ(tree.types[root], JIT::parser::Token::OPERATION);
+    EXPECT_EQ(tree.operations[root], JIT::parser::Operation::MULTIPLY);
+    EXPECT_EQ(tree.num_children[root], 2);
+
+    auto call = tree.Child(root, 0);
+    EXPECT_EQ(tree.types[call], JIT::parser::Token::FUNCTION);
+    EXPECT_EQ(tree.names[call], "f");
+    EXPECT_EQ(tree.num_children[call], 2);
+    EXPECT_EQ(tree.operations[tree.Child(call, 0)], JIT::parser::Operation::PLUS);
+    EXPECT_EQ(tree.names[tree.Child(call, 1)], "a");
+
+    auto minus = tree.Child(root, 1);
+    EXPECT_EQ(tree.operations[minus], JIT::parser::Operation::UNARY_MINUS);
+    EXPECT_EQ(tree.num_children[minus], 1);
+    EXPECT_EQ(tree.numbers[tree.Child(minus, 0)], 3);
+    for (uint32_t node = 0; node < tree.Size(); ++node) {
+        for (uint32_t i = 0; i < tree.num_children[node]; ++i) {
+            EXPECT_LT(tree.Child(node, i), node);
+        }
+    }
+}
+
+TEST(ExpressionTree, Incorrect) {
+    std::string incorrect_samples[] = {"", "-", "(1,2)", "1+2)*3", "1+*3"};
+
+    for (const auto& sample : incorrect_samples) {
+        EXPECT_ANY_THROW(JIT::parser::ConvertToExpressionTree(JIT::parser::SplitToTokens(sample)));
+    }
+}
+
+// Large enough to be parsed in many chunks
+std::string RepeatExpression(const std::string& part, const std::string& separator) {
+    std::string result = part;
+    while (result.size() < (1 << 20)) {
+        result += separator + part;
+    }
+    return result;
+}
+
+void ExpectSameTokens(const std::vector<JIT::parser::Token>& first,
+                      const std::vector<JIT::parser::Token>& second) {
+    ASSERT_EQ(first.size(), second.size());
+    for (uint32_t i = 0; i < first.size(); ++i) {
+        ASSERT_EQ(first[i].type, second[i].type) << i;
+        ASSERT_EQ(first[i].text.data(), second[i].text.data()) << i;
+        if (first[i].type == JIT::parser::Token::OPERATION) {
+            ASSERT_EQ(first[i].operation, second[i].operation) << i;
+        } else if (first[i].type == JIT::parser::Token::NUMBER) {
+            ASSERT_EQ(first[i].number, second[i].number) << i;
+        } else if (first[i].type == JIT::parser::Token::FUNCTION) {
+            ASSERT_EQ(first[i].num_arguments, second[i].num_arguments) << i;
+        }
+    }
+}
+
+TEST(ParallelParser, SameAsSequential) {
+    JIT::parser::ThreadPool pool(4);
+    std::string samples[] = {
+        RepeatExpression("sum(a, -b*(c+10), dec(d)) * 3", " - "),
+        RepeatExpression("a*b - -c", "+"),
+        "(" + RepeatExpression("f(x1, (y-2)*z, g())", "+") + ")*2",
+        RepeatExpression("1", "-") + "-(((" + RepeatExpression("a", "+") + ")))"
+    };
+
+    for (const auto& sample : samples) {
+        auto sequential = JIT::parser::ConvertToPostfixNotation(JIT::parser::SplitToTokens(sample));
+        ExpectSameTokens(JIT::parser::ConvertToPostfixNotationParallel(sample, pool), sequential);
+    }
+}
+
+TEST(ParallelParser, Errors) {
+    JIT::parser::ThreadPool pool(4);
+    std::string correct = RepeatExpression("f(a, 2)", "+");
+    std::string incorrect_samples[] = {correct + "+", "(" + correct, correct + ")",
+                                       correct + "(1, 2)", correct + "$", "f(1, " + correct};
+
+    for (const auto& sample : incorrect_samples) {
+        std::vector<JIT::parser::Token> tokens, sequential, parallel;
+        auto sequential_error = JIT::parser::SplitToTokens(sample, tokens);
+        if (!sequential_error) {
+            sequential_error = JIT::parser::ConvertToPostfixNotation(sample, tokens, sequential);
+        }
+        auto parallel_error = JIT::parser::ConvertToPostfixNotationParallel(sample, pool, parallel);
+        EXPECT_NE(parallel_error.kind, JIT::parser::ErrorKind::NONE);
+        EXPECT_EQ(parallel_error.kind, sequential_error.kind);
+        EXPECT_EQ(parallel_error.position, sequential_error.position);
+    }
+}
+
 int32_t a = 0, b = 1, c = 2, d = 239;
 
 int32_t sum(int32_t a, int32_t b, int32_t c) {
@@ -164,10 +345,10 @@ void FreeCodeBuffer(void* buf) {
     munmap(buf, 4096);
 }
 
-int32_t Execute(const std::string &expr) {
+int32_t Execute(const std::string &expr, compiler_t compiler = jit_compile_expression_to_arm) {
     void* buf = InitCodeBuffer();
     try {
-        jit_compile_expression_to_arm(expr.c_str(), symbols, buf);
+        compiler(expr.c_str(), symbols, buf);
         function_t func = reinterpret_cast<function_t>(buf);
         int32_t result = func();
         FreeCodeBuffer(buf);
@@ -182,6 +363,718 @@ TEST(Translator, Corectness) {
     EXPECT_EQ(Execute("sum(2+3*dec(d), a)-(-c)"), 718);
 }
 
+TEST(Translator, ErrorPositions) {
+    struct Sample {
+        std::string expr;
+        JIT::parser::ErrorKind kind;
+        uint32_t position;
+    } samples[] = {
+        {"1+2 3", JIT::parser::ErrorKind::MISSING_OPERATOR, 4},
+        {"1+*3", JIT::parser::ErrorKind::MISSING_OPERAND, 2},
+        {"1 +", JIT::parser::ErrorKind::MISSING_OPERAND, 3},
+        {"", JIT::parser::ErrorKind::MISSING_OPERAND, 0},
+        {"1+2)*3", JIT::parser::ErrorKind::MISSING_OPEN_BRACKET, 3},
+        {"(1+2", JIT::parser::ErrorKind::MISSING_CLOSE_BRACKET, 0},
+        {"a+sum(1, 2", JIT::parser::ErrorKind::MISSING_CLOSE_BRACKET, 5},
+        {"1 + #", JIT::parser::ErrorKind::UNKNOWN_SYMBOL, 4},
+        {"a * e", JIT::parser::ErrorKind::UNDEFINED_SYMBOL, 4},
+    };
+    uint32_t command_list[1024];
+
+    for (const auto& sample : samples) {
+        jit_error_t error;
+        EXPECT_EQ(jit_compile_expression_to_arm_checked(sample.expr.c_str(), symbols,
+                                                        command_list, &error), 0);
+        EXPECT_EQ(error.kind, static_cast<int>(sample.kind));
+        EXPECT_EQ(error.position, sample.position);
+    }
+
+    jit_error_t error;
+    EXPECT_EQ(jit_compile_expression_to_arm_checked("a * b", symbols, command_list, &error), 1);
+    EXPECT_EQ(error.kind, 0);
+}
+
+std::unordered_map<std::string_view, void*> GetExternsMap() {
+    std::unordered_map<std::string_view, void*> externs_map;
+    for (auto symbol = symbols; symbol->name != nullptr; ++symbol) {
+        externs_map[symbol->name] = symbol->pointer;
+    }
+    return externs_map;
+}
+
+std::vector<uint32_t> CompileToCommandList(const std::string& expr) {
+    auto postfix = JIT::parser::ConvertToPostfixNotation(JIT::parser::SplitToTokens(expr));
+    return JIT::translator::GetARMCommandList(postfix, GetExternsMap());
+}
+
+TEST(Translator, ConstantFolding) {
+    EXPECT_EQ(CompileToCommandList("2*3+a*(4-4)"), CompileToCommandList("6+a*0"));
+    EXPECT_EQ(CompileToCommandList("-5"), CompileToCommandList("4294967291"));
+    EXPECT_EQ(CompileToCommandList("--(2-3)*sum(1*1)"), CompileToCommandList("4294967295*sum(1)"));
+    EXPECT_EQ(CompileToCommandList("65536*65536+a"), CompileToCommandList("0+a"));
+    EXPECT_EQ(CompileToCommandList("-(7)").size(), CompileToCommandList("7").size());
+}
+
+TEST(Translator, Immediates) {
+    namespace command_code = JIT::translator::command_code;
+    // push {r4, lr}, setting r0, pop {r4, lr} and bx lr
+    EXPECT_EQ(CompileToCommandList("0").size(), 4);
+    EXPECT_EQ(CompileToCommandList("255").size(), 4);
+    EXPECT_EQ(CompileToCommandList("3221225472").size(), 4);
+    EXPECT_EQ(CompileToCommandList("-256").size(), 4);
+    EXPECT_EQ(CompileToCommandList("65535").size(), 4);
+    EXPECT_EQ(CompileToCommandList("65537").size(), 5);
+
+    auto contains = [](const std::string& expr, uint32_t command) {
+        auto command_list = CompileToCommandList(expr);
+        return std::find(command_list.begin(), command_list.end(), command) != command_list.end();
+    };
+    EXPECT_TRUE(contains("a+1", command_code::DataImmediate(command_code::ADD, 0, 0, 1)));
+    EXPECT_TRUE(contains("a-(2+3)", command_code::DataImmediate(command_code::SUB, 0, 0, 5)));
+    EXPECT_TRUE(contains("a+-1", command_code::DataImmediate(command_code::SUB, 0, 0, 1)));
+    EXPECT_TRUE(contains("-a", command_code::DataImmediate(command_code::RSB, 0, 0, 0)));
+    EXPECT_TRUE(contains("a*-1", command_code::DataImmediate(command_code::MVN, 1, 0, 0)));
+    // The constant is not set to a register, pushed and popped
+    EXPECT_EQ(CompileToCommandList("a+1").size() + 3, CompileToCommandList("1+a").size());
+}
+
+// Names in the function refer to expr
+JIT::optimizer::Function BuildFunction(std::string_view expr) {
+    auto postfix = JIT::parser::ConvertToPostfixNotation(JIT::parser::SplitToTokens(expr));
+    JIT::optimizer::Function function;
+    JIT::optimizer::BuildFunction(expr, postfix, GetExternsMap(), function);
+    return function;
+}
+
+TEST(FastCompiler, SameCode) {
+    std::string samples[] = {"1", "a - b - c", "-a*b", "2 * -3", "a--b",
+                             "sum(2+3*dec(d), a)-(-c)", "(a+b)*(c-(d*2))",
+                             "2*3+a*(4-4)", "-(1+2)*-a - -(5)", "1+2+a+3*4"};
+
+    for (const auto& sample : samples) {
+        std::vector<uint32_t> command_list(1024);
+        command_list.resize(JIT::translator::CompileExpressionFast(sample, symbols,
+                                                                   command_list.data()));
+        EXPECT_EQ(command_list, CompileToCommandList(sample));
+    }
+}
+
+TEST(FastCompiler, Errors) {
+    uint32_t command_list[1024];
+
+    EXPECT_THROW(JIT::translator::CompileExpressionFast("(1+2", symbols, command_list),
+                 JIT::parser::missing_close_bracket);
+    EXPECT_THROW(JIT::translator::CompileExpressionFast("1+2)*3", symbols, command_list),
+                 JIT::parser::missing_open_bracket);
+    EXPECT_THROW(JIT::translator::CompileExpressionFast("1+2 3", symbols, command_list),
+                 JIT::parser::missing_operator);
+    EXPECT_THROW(JIT::translator::CompileExpressionFast("sum(a-, 2)", symbols, command_list),
+                 JIT::parser::missing_operand);
+    EXPECT_THROW(JIT::translator::CompileExpressionFast("1+@", symbols, command_list),
+                 JIT::parser::unknown_symbol);
+    EXPECT_THROW(JIT::translator::CompileExpressionFast("e+1", symbols, command_list),
+                 std::out_of_range);
+}
+
+TEST(FastCompiler, DuplicateSymbols) {
+    // The last of equal names wins with both lookups, as in the default path
+    symbol_t duplicates[] = {{"a", &a}, {"a", &b}, {nullptr, nullptr}};
+    std::unordered_map<std::string_view, void*> externs_map = {{"a", &b}};
+    auto postfix = JIT::parser::ConvertToPostfixNotation(JIT::parser::SplitToTokens("a"));
+    std::vector<uint32_t> expected = JIT::translator::GetARMCommandList(postfix, externs_map);
+
+    std::vector<uint32_t> command_list(1024);
+    command_list.resize(JIT::translator::CompileExpressionFast("a", duplicates, command_list.data()));
+    EXPECT_EQ(command_list, expected);
+
+    char scratch[256];
+    JIT::translator::Arena arena(scratch, sizeof(scratch));
+    command_list.resize(1024);
+    command_list.resize(JIT::translator::CompileExpressionFast("a", duplicates, command_list.data(), arena));
+    EXPECT_EQ(command_list, expected);
+}
+
+TEST(FastCompiler, Corectness) {
+    EXPECT_EQ(Execute("sum(2+3*dec(d), a)-(-c)", jit_compile_expression_to_arm_fast), 718);
+}
+
+TEST(ArenaCompiler, NoAllocations) {
+    uint32_t command_list[1024];
+    char scratch[256];
+
+    uint32_t num_allocations_before = num_allocations;
+    int result = jit_compile_expression_to_arm_in_arena("sum(2+3*dec(d), a)-(-c)", symbols,
+                                                        command_list, scratch, sizeof(scratch));
+    uint32_t num_allocations_after = num_allocations;
+    EXPECT_EQ(result, 1);
+    EXPECT_EQ(num_allocations_after, num_allocations_before);
+
+    std::vector<uint32_t> expected = CompileToCommandList("sum(2+3*dec(d), a)-(-c)");
+    EXPECT_TRUE(std::equal(expected.begin(), expected.end(), command_list));
+}
+
+TEST(ArenaCompiler, SmallArena) {
+    uint32_t command_list[1024];
+    char scratch[4];
+
+    JIT::translator::Arena arena(scratch, sizeof(scratch));
+    EXPECT_THROW(JIT::translator::CompileExpressionFast("a+b", symbols, command_list, arena),
+                 std::bad_alloc);
+}
+
+TEST(ArenaCompiler, Corectness) {
+    compiler_t compiler = [](const char* expression, const symbol_t* externs, void* out_buffer) {
+        char scratch[256];
+        return jit_compile_expression_to_arm_in_arena(expression, externs, out_buffer,
+                                                      scratch, sizeof(scratch));
+    };
+    EXPECT_EQ(Execute("sum(2+3*dec(d), a)-(-c)", compiler), 718);
+}
+
+static constexpr char static_expression[] = "sum(2+3*dec(d), a)-(-c)";
+constexpr auto static_code = JIT::translator::Compile<static_expression>();
+
+static_assert(static_code.relocations.size() == 5, "Every symbol reference is relocated");
+static_assert(static_code.relocations[0].name == "d", "Symbols are relocated in code order");
+
+TEST(StaticCompiler, SameCode) {
+    std::vector<uint32_t> command_list(static_code.commands.size());
+    JIT::translator::Link(static_code, symbols, command_list.data());
+    EXPECT_EQ(command_list, CompileToCommandList(static_expression));
+
+    symbol_t no_symbols[] = {{nullptr, nullptr}};
+    EXPECT_THROW(JIT::translator::Link(static_code, no_symbols, command_list.data()),
+                 std::out_of_range);
+}
+
+TEST(StaticCompiler, Corectness) {
+    compiler_t compiler = [](const char*, const symbol_t* externs, void* out_buffer) {
+        JIT::translator::Link(static_code, externs, static_cast<uint32_t*>(out_buffer));
+        return 1;
+    };
+    EXPECT_EQ(Execute(static_expression, compiler), 718);
+}
+
+TEST(Optimizer, BuildFunction) {
+    EXPECT_EQ(JIT::optimizer::Print(BuildFunction("sum(a, 2) - -b")),
+              "%0 = load a\n%1 = const 2\n%2 = call sum, %0, %1\n"
+              "%3 = load b\n%4 = neg %3\n%5 = sub %2, %4\nret %5\n");
+}
+
+TEST(Optimizer, DeadCodeElimination) {
+    auto function = BuildFunction("a*2 + dec(b)");
+    // Unused load is removed, unused call and its argument are kept
+    function.Append(function[3]);
+    auto argument = function.Append(JIT::optimizer::MakeOperation(JIT::optimizer::Opcode::NEG, {0}));
+    auto call = function[4];
+    call.operands = {argument};
+    function.Append(call);
+
+    JIT::optimizer::CreateDeadCodeElimination()->Run(function);
+    EXPECT_EQ(JIT::optimizer::Print(function),
+              "%0 = load a\n%1 = const 2\n%2 = mul %0, %1\n%3 = load b\n%4 = call dec, %3\n"
+              "%5 = add %2, %4\n%6 = neg %0\n%7 = call dec, %6\nret %5\n");
+}
+
+TEST(Optimizer, ConstantFolding) {
+    auto function = BuildFunction("2*3+a*(4-4) - -(65536*65536-1)");
+    JIT::optimizer::CreateConstantFolding()->Run(function);
+    JIT::optimizer::CreateDeadCodeElimination()->Run(function);
+    EXPECT_EQ(JIT::optimizer::Print(function),
+              "%0 = const 6\n%1 = load a\n%2 = const 0\n%3 = mul %1, %2\n%4 = add %0, %3\n"
+              "%5 = const 1\n%6 = sub %4, %5\nret %6\n");
+}
+
+TEST(Optimizer, CommonSubexpressionElimination) {
+    auto function = BuildFunction("(a+b)*(b+a) + dec(a)*a");
+    JIT::optimizer::CreateCommonSubexpressionElimination(true)->Run(function);
+    EXPECT_EQ(JIT::optimizer::Print(function),
+              "%0 = load a\n%1 = load b\n%2 = add %0, %1\n%3 = mul %2, %2\n%4 = call dec, %0\n"
+              "%5 = load a\n%6 = mul %4, %5\n%7 = add %3, %6\nret %7\n");
+
+    // Without aliasing every variable is loaded once
+    function = BuildFunction("dec(a)*a - dec(a)");
+    JIT::optimizer::CreateCommonSubexpressionElimination(false)->Run(function);
+    EXPECT_EQ(JIT::optimizer::Print(function),
+              "%0 = load a\n%1 = call dec, %0\n%2 = mul %1, %0\n%3 = call dec, %0\n"
+              "%4 = sub %2, %3\nret %4\n");
+}
+
+std::string Simplify(std::string_view expr) {
+    auto function = BuildFunction(expr);
+    JIT::optimizer::CreateCommonSubexpressionElimination(true)->Run(function);
+    JIT::optimizer::CreateAlgebraicSimplification()->Run(function);
+    JIT::optimizer::CreateDeadCodeElimination()->Run(function);
+    return JIT::optimizer::Print(function);
+}
+
+TEST(Optimizer, AlgebraicSimplification) {
+    EXPECT_EQ(Simplify("a*1 + 0 - b*0"), "%0 = load a\nret %0\n");
+    EXPECT_EQ(Simplify("(a - a) + -(-b)"), "%0 = load b\nret %0\n");
+    EXPECT_EQ(Simplify("a - -b"), "%0 = load a\n%1 = load b\n%2 = add %0, %1\nret %2\n");
+    EXPECT_EQ(Simplify("1+a+2"), "%0 = load a\n%1 = const 3\n%2 = add %0, %1\nret %2\n");
+    EXPECT_EQ(Simplify("1+a-b+2"),
+              "%0 = load a\n%1 = load b\n%2 = sub %0, %1\n%3 = const 3\n%4 = add %2, %3\nret %4\n");
+    EXPECT_EQ(Simplify("a*b + a*c"),
+              "%0 = load a\n%1 = load b\n%2 = load c\n%3 = add %1, %2\n%4 = mul %0, %3\nret %4\n");
+    EXPECT_EQ(Simplify("2*a*3 - a*4"), "%0 = const 2\n%1 = load a\n%2 = mul %1, %0\nret %2\n");
+    // Calls are kept even if their values are not needed
+    EXPECT_EQ(Simplify("dec(a)*0"), "%0 = load a\n%1 = call dec, %0\n%2 = const 0\nret %2\n");
+    EXPECT_EQ(Simplify("a - dec(b) - a"),
+              "%0 = load a\n%1 = load b\n%2 = call dec, %1\n%3 = sub %0, %2\n%4 = load a\n"
+              "%5 = sub %3, %4\nret %5\n");
+}
+
+TEST(Optimizer, SimplificationKeepsSharedValues) {
+    // Factoring would compute a*b twice
+    auto function = BuildFunction("a*b + a*c");
+    JIT::optimizer::CreateCommonSubexpressionElimination(true)->Run(function);
+    function.Append(JIT::optimizer::MakeOperation(JIT::optimizer::Opcode::MUL, {2, 5}));
+    function.result = function.Size() - 1;
+    JIT::optimizer::CreateAlgebraicSimplification()->Run(function);
+    EXPECT_EQ(JIT::optimizer::Print(function),
+              "%0 = load a\n%1 = load b\n%2 = mul %0, %1\n%3 = load c\n%4 = mul %0, %3\n"
+              "%5 = add %2, %4\n%6 = mul %2, %5\nret %6\n");
+}
+
+std::string RewriteToHorner(std::string_view expr) {
+    auto function = BuildFunction(expr);
+    JIT::optimizer::CreateCommonSubexpressionElimination(true)->Run(function);
+    JIT::optimizer::CreateHornerRewriting()->Run(function);
+    JIT::optimizer::CreateAlgebraicSimplification()->Run(function);
+    JIT::optimizer::CreateDeadCodeElimination()->Run(function);
+    return JIT::optimizer::Print(function);
+}
+
+TEST(Optimizer, HornerRewriting) {
+    EXPECT_EQ(RewriteToHorner("a*a*a + b*a*a + c*a + d"),
+              "%0 = load a\n%1 = load b\n%2 = load c\n%3 = load d\n%4 = add %0, %1\n%5 = mul %4, %0\n"
+              "%6 = add %5, %2\n%7 = mul %6, %0\n%8 = add %7, %3\nret %8\n");
+    // Coefficients wrap around like the original products
+    EXPECT_EQ(RewriteToHorner("3*a*a - a*a*a*b + 5"),
+              "%0 = const 3\n%1 = load a\n%2 = load b\n%3 = const 5\n%4 = neg %2\n%5 = mul %4, %1\n"
+              "%6 = add %5, %0\n%7 = mul %6, %1\n%8 = mul %7, %1\n%9 = add %8, %3\nret %9\n");
+    // Nothing to save
+    EXPECT_EQ(RewriteToHorner("a*a + b"), "%0 = load a\n%1 = mul %0, %0\n%2 = load b\n%3 = add %1, %2\nret %3\n");
+
+    // Trees too large are left as they are, however deep
+    for (char operation : {'+', '*'}) {
+        std::string expr = "a";
+        for (uint32_t i = 1; i < 100000; ++i) {
+            expr += operation;
+            expr += "abcd"[i % 4];
+        }
+        auto function = BuildFunction(expr);
+        std::string printed = JIT::optimizer::Print(function);
+        JIT::optimizer::CreateHornerRewriting()->Run(function);
+        EXPECT_EQ(JIT::optimizer::Print(function), printed);
+    }
+}
+
+std::string Rebalance(std::string_view expr, bool calls_modify_variables = true) {
+    auto function = BuildFunction(expr);
+    JIT::optimizer::CreateRebalancing(calls_modify_variables)->Run(function);
+    return JIT::optimizer::Print(function);
+}
+
+TEST(Optimizer, Rebalancing) {
+    EXPECT_EQ(Rebalance("a+b+c+d+5"),
+              "%0 = load a\n%1 = load b\n%2 = add %0, %1\n%3 = load c\n%4 = load d\n%5 = add %3, %4\n"
+              "%6 = add %2, %5\n%7 = const 5\n%8 = add %6, %7\nret %8\n");
+    // Products are accumulated last to fit mla
+    EXPECT_EQ(Rebalance("a*b + c*d + a + b + c"),
+              "%0 = load a\n%1 = load b\n%2 = add %0, %1\n%3 = load c\n%4 = add %2, %3\n%5 = load a\n"
+              "%6 = load b\n%7 = mul %5, %6\n%8 = add %4, %7\n%9 = load c\n%10 = load d\n%11 = mul %9, %10\n"
+              "%12 = add %8, %11\nret %12\n");
+    // Operand needing more registers goes first
+    EXPECT_EQ(Rebalance("a - b*(c+d)"),
+              "%0 = load c\n%1 = load d\n%2 = add %0, %1\n%3 = load b\n%4 = mul %3, %2\n%5 = load a\n"
+              "%6 = sub %5, %4\nret %6\n");
+    // Loads don't cross calls which may change variables
+    EXPECT_EQ(Rebalance("a - dec(b*(c+d))"),
+              "%0 = load c\n%1 = load d\n%2 = add %0, %1\n%3 = load b\n%4 = mul %3, %2\n%5 = load a\n"
+              "%6 = call dec, %4\n%7 = sub %5, %6\nret %7\n");
+    EXPECT_EQ(Rebalance("a - dec(b*(c+d))", false),
+              "%0 = load c\n%1 = load d\n%2 = add %0, %1\n%3 = load b\n%4 = mul %3, %2\n"
+              "%5 = call dec, %4\n%6 = load a\n%7 = sub %6, %5\nret %7\n");
+}
+
+TEST(Optimizer, RebalancingKeepsRegisters) {
+    namespace command_code = JIT::translator::command_code;
+    struct Code {
+        uint32_t num_stack_accesses = 0;
+        uint32_t num_saved_registers = 0;
+        size_t size = 0;
+    };
+    auto compile = [](const std::string& expr, JIT::optimizer::OptimizationLevel level) {
+        JIT::translator::CompileOptions options;
+        options.optimizer.level = level;
+        std::vector<uint32_t> command_list;
+        EXPECT_FALSE(JIT::translator::CompileExpression(expr, symbols, options, command_list));
+        Code code;
+        for (uint32_t command : command_list) {
+            // ldr and str differ in bit 20
+            code.num_stack_accesses += (command & 0xFFEF0000) == command_code::StoreImmediate(0, command_code::SP, 0);
+        }
+        code.num_saved_registers = __builtin_popcount(command_list.front() & 0xFFFF);
+        code.size = command_list.size();
+        return code;
+    };
+    // Leaves shared after CSE stay live through the chain, partial results must
+    // not push them out of registers
+    for (uint32_t length : {40, 20000}) {
+        std::string expr = "a";
+        for (uint32_t i = 1; i < length; ++i) {
+            expr += '+';
+            expr += "abcd"[i % 4];
+        }
+        Code o1 = compile(expr, JIT::optimizer::OptimizationLevel::O1),
+             o2 = compile(expr, JIT::optimizer::OptimizationLevel::O2);
+        EXPECT_LE(o2.num_stack_accesses, o1.num_stack_accesses);
+        EXPECT_LE(o2.num_saved_registers, o1.num_saved_registers);
+    }
+
+    // Values computed before an impure call are combined right after it, and
+    // chains of calls are not split, so fewer values live across calls
+    std::string samples[] = {
+        "(((dec(b)-(a+c))-dec(6))-((((d+a)-(b+d))+a)+b))",
+        "-(((((8+8)--2)-((a*d)+dec(d)))+(((a-c)+c)-((a*7)-(8-b))))+((((2-9)*(a-b))*c)-((4*7)--b)))",
+        "((dec(0)*4)*((((-a-dec(7))+(a--d))+((d*d)*((4+a)*(0-c))))+((dec(c*b)-((a+0)+(a*d)))+"
+        "(((1-7)*4)+((5-b)-(c*c))))))",
+        "(((4-(((a-a)+(3*a))-a))*(-a*(((b+4)-(b+b))+(dec(a)*(b+d)))))+((((-1*(8*a))+((c+0)-(4+b)))-"
+        "(c+((c*b)-(b+b))))+((-(6-c)*((a+7)*(b*6)))+-9)))"
+    };
+    for (const auto& sample : samples) {
+        Code o1 = compile(sample, JIT::optimizer::OptimizationLevel::O1),
+             o2 = compile(sample, JIT::optimizer::OptimizationLevel::O2);
+        EXPECT_LE(o2.num_stack_accesses, o1.num_stack_accesses) << sample;
+        EXPECT_LE(o2.size, o1.size) << sample;
+    }
+    std::string expr = "dec(0)";
+    for (uint32_t i = 1; i < 16; ++i) {
+        expr += "+dec(" + std::to_string(i) + ")";
+    }
+    EXPECT_EQ(compile(expr, JIT::optimizer::OptimizationLevel::O2).num_stack_accesses, 0);
+    EXPECT_EQ(Rebalance("a+b+c+d+a+b"),
+              "%0 = load a\n%1 = load b\n%2 = add %0, %1\n%3 = load c\n%4 = load d\n%5 = add %3, %4\n"
+              "%6 = add %2, %5\n%7 = load a\n%8 = load b\n%9 = add %7, %8\n%10 = add %6, %9\nret %10\n");
+}
+
+std::string Saturate(std::string_view expr) {
+    auto function = BuildFunction(expr);
+    JIT::optimizer::CreateEqualitySaturation(JIT::optimizer::DEFAULT_SATURATION_BUDGET)->Run(function);
+    return JIT::optimizer::Print(function);
+}
+
+TEST(Optimizer, EqualitySaturation) {
+    EXPECT_EQ(Saturate("a*9 - a"), "%0 = load a\n%1 = const 8\n%2 = mul %0, %1\nret %2\n");
+    // Shift and addition cost more than multiplication, as x is used twice
+    EXPECT_EQ(Saturate("(a+b)*3 - b*3"), "%0 = load a\n%1 = const 3\n%2 = mul %0, %1\nret %2\n");
+    EXPECT_EQ(Saturate("a*b + b*c - b*(a-1)"),
+              "%0 = load b\n%1 = load c\n%2 = const 1\n%3 = add %1, %2\n%4 = mul %0, %3\nret %4\n");
+    EXPECT_EQ(Saturate("-(a*-b) + 0*c"), "%0 = load a\n%1 = load b\n%2 = mul %0, %1\nret %2\n");
+    // Impure calls keep the function as it is
+    EXPECT_EQ(Saturate("dec(a)*9 - a"),
+              "%0 = load a\n%1 = call dec, %0\n%2 = const 9\n%3 = mul %1, %2\n%4 = load a\n"
+              "%5 = sub %3, %4\nret %5\n");
+}
+
+std::string OptimizeWithInfos(std::string_view expr) {
+    std::unordered_map<std::string_view, JIT::optimizer::SymbolInfo> infos = {
+        {"sum", {3, JIT::optimizer::Purity::CONST, 10}},
+        {"dec", {1, JIT::optimizer::Purity::PURE, 5}}
+    };
+    auto postfix = JIT::parser::ConvertToPostfixNotation(JIT::parser::SplitToTokens(expr));
+    JIT::optimizer::Function function;
+    JIT::optimizer::BuildFunction(expr, postfix, GetExternsMap(), function, infos);
+    JIT::optimizer::CreatePassManager({}).Run(function);
+    return JIT::optimizer::Print(function);
+}
+
+TEST(Optimizer, PureCalls) {
+    // Constant calls are made at compile time, pure ones are merged or removed
+    EXPECT_EQ(OptimizeWithInfos("sum(1, 2, 3) + dec(a)*dec(a) + 0*dec(b)"),
+              "%0 = load a\n%1 = call dec, %0\n%2 = mul %1, %1\n%3 = const 6\n%4 = add %2, %3\nret %4\n");
+    // Calls with unexpected number of arguments are impure
+    EXPECT_EQ(OptimizeWithInfos("sum(1, 2) + dec(b, 1) - dec(b, 1)"),
+              "%0 = const 1\n%1 = const 2\n%2 = call sum, %0, %1\n%3 = load b\n%4 = call dec, %3, %0\n"
+              "%5 = add %2, %4\n%6 = load b\n%7 = call dec, %6, %0\n%8 = sub %5, %7\nret %8\n");
+}
+
+TEST(StrengthReduction, Sequences) {
+    struct Sample {
+        uint32_t multiplier;
+        uint32_t length;
+    } samples[] = {
+        {1, 0}, {8, 1}, {5, 1}, {static_cast<uint32_t>(-7), 1}, {static_cast<uint32_t>(-1), 1},
+        {45, 2}, {10, 2}, {static_cast<uint32_t>(-9), 2}, {11, 2}, {100, 3}, {0x80000001, 1}
+    };
+    std::vector<JIT::translator::MultiplicationStep> sequence;
+    for (const auto& sample : samples) {
+        ASSERT_TRUE(JIT::translator::FindMultiplicationSequence(sample.multiplier, sequence));
+        EXPECT_EQ(sequence.size(), sample.length) << sample.multiplier;
+        for (uint32_t x : {1u, 7u, 0xDEADBEEFu}) {
+            EXPECT_EQ(JIT::translator::EvaluateMultiplicationSequence(sequence, x), x * sample.multiplier);
+        }
+    }
+
+    uint32_t multiplier = 1;
+    for (uint32_t i = 0; i < 1000; ++i) {
+        multiplier = multiplier * 1103515245 + 12345;
+        if (JIT::translator::FindMultiplicationSequence(multiplier, sequence)) {
+            EXPECT_LE(sequence.size(), 3);
+            EXPECT_EQ(JIT::translator::EvaluateMultiplicationSequence(sequence, 3), 3 * multiplier);
+        }
+    }
+}
+
+bool ContainsCommand(const std::string& expr, uint32_t command) {
+    JIT::translator::CompileOptions options;
+    std::vector<uint32_t> command_list;
+    EXPECT_FALSE(JIT::translator::CompileExpression(expr, symbols, options, command_list));
+    return std::find(command_list.begin(), command_list.end(), command) != command_list.end();
+}
+
+TEST(CodeGenerator, InstructionSelection) {
+    namespace command_code = JIT::translator::command_code;
+    // Variables are loaded to r4, r5 and r6 in order, the result is computed to r0
+    EXPECT_TRUE(ContainsCommand("a*b + c", command_code::MultiplyAccumulate(0, 4, 5, 6)));
+    EXPECT_FALSE(ContainsCommand("a*b + c", command_code::Multiply(4, 4, 5)));
+    EXPECT_TRUE(ContainsCommand("c - a*b", command_code::MultiplySubtract(0, 4, 5, 6)));
+    EXPECT_TRUE(ContainsCommand("a + b*4", command_code::DataRegister(command_code::ADD, 0, 4, 5,
+                                                                      command_code::LSL, 2)));
+    EXPECT_TRUE(ContainsCommand("a*8 - b", command_code::DataRegister(command_code::RSB, 0, 5, 4,
+                                                                      command_code::LSL, 3)));
+    EXPECT_TRUE(ContainsCommand("0 - a", command_code::DataImmediate(command_code::RSB, 0, 4, 0)));
+    EXPECT_TRUE(ContainsCommand("7 - a", command_code::DataImmediate(command_code::RSB, 0, 4, 7)));
+    // Shared product is computed once
+    EXPECT_TRUE(ContainsCommand("a*b + c + a*b*d", command_code::Multiply(4, 4, 5)));
+    // Short sequences beat mov and mul, but three steps don't
+    EXPECT_TRUE(ContainsCommand("a*5", command_code::DataRegister(command_code::ADD, 0, 4, 4,
+                                                                  command_code::LSL, 2)));
+    EXPECT_TRUE(ContainsCommand("a*100", command_code::DataImmediate(command_code::MOV, 1, 0, 100)));
+    EXPECT_TRUE(ContainsCommand("a*100", command_code::Multiply(0, 4, 1)));
+}
+
+// Variables at known distances: x and y are close, z is out of reach of ldr
+// offsets from them
+int32_t block[2048] = {};
+
+symbol_t block_symbols[] =
+{
+    {"x", &block[0]},
+    {"y", &block[1]},
+    {"z", &block[2047]},
+    {nullptr, nullptr}
+};
+
+TEST(CodeGenerator, RegisterAllocation) {
+    namespace command_code = JIT::translator::command_code;
+    JIT::translator::CompileOptions options;
+    std::vector<uint32_t> command_list;
+    EXPECT_FALSE(JIT::translator::CompileExpression("x+z", block_symbols, options, command_list));
+    // r6 keeps the stack aligned
+    EXPECT_EQ(command_list.front(), command_code::Push(0x4070));
+    EXPECT_EQ(command_list[command_list.size() - 2], command_code::DataRegister(command_code::ADD, 0, 4, 5));
+    EXPECT_EQ(command_list.back(), command_code::Pop(0x8070));
+
+    // Values live in callee-saved registers across calls
+    EXPECT_TRUE(ContainsCommand("dec(a)*b + dec(c)", command_code::MultiplyAccumulate(0, 4, 5, 6)));
+
+    // Results of calls stay alive until the last one. Values are spilled only
+    // when registers run out
+    auto count_stores = [](const std::string& expr) {
+        JIT::translator::CompileOptions options;
+        std::vector<uint32_t> command_list;
+        EXPECT_FALSE(JIT::translator::CompileExpression(expr, symbols, options, command_list));
+        return std::count_if(command_list.begin(), command_list.end(), [](uint32_t command) {
+            return (command & 0xFFFF0000) == command_code::StoreImmediate(0, command_code::SP, 0);
+        });
+    };
+    // The address of dec doesn't take a register needed for values
+    std::string expr = "dec(0)";
+    for (uint32_t i = 1; i < 8; ++i) {
+        expr = "dec(" + std::to_string(i) + ")-(" + expr + ")";
+    }
+    EXPECT_EQ(count_stores(expr), 0);
+    for (uint32_t i = 8; i < 12; ++i) {
+        expr = "dec(" + std::to_string(i) + ")-(" + expr + ")";
+    }
+    EXPECT_GT(count_stores(expr), 0);
+}
+
+TEST(CodeGenerator, BaseRegister) {
+    namespace command_code = JIT::translator::command_code;
+    JIT::translator::CompileOptions options;
+    std::vector<uint32_t> command_list;
+    EXPECT_FALSE(JIT::translator::CompileExpression("x+y+z", block_symbols, options, command_list));
+    // r11 keeps the address of x
+    EXPECT_EQ(command_list.front(), command_code::Push(0x4830));
+    auto load = std::find(command_list.begin(), command_list.end(), command_code::LoadImmediate(4, 11, 0));
+    ASSERT_NE(load, command_list.end());
+    EXPECT_EQ(load[1], command_code::LoadImmediate(5, 11, 4));
+    // z is out of reach and loaded by its address
+    EXPECT_NE(std::find(command_list.begin(), command_list.end(), command_code::LoadImmediate(5, 5, 0)),
+              command_list.end());
+
+    // A single variable is loaded by its address
+    command_list.clear();
+    EXPECT_FALSE(JIT::translator::CompileExpression("x*z", block_symbols, options, command_list));
+    EXPECT_EQ(command_list.front(), command_code::Push(0x4070));
+}
+
+TEST(CodeGenerator, Calls) {
+    namespace command_code = JIT::translator::command_code;
+    // Never called: f is in reach of bl from the code, g is not
+    symbol_t call_symbols[] = {
+        {"f", reinterpret_cast<void*>(0x100000)},
+        {"g", reinterpret_cast<void*>(0x8000000)},
+        {nullptr, nullptr}
+    };
+    auto compile = [&call_symbols](const std::string& expr, uint32_t code_address,
+                                   const symbol_info_t* symbol_infos = nullptr) {
+        JIT::translator::CompileOptions options;
+        options.code_address = code_address;
+        options.symbol_infos = symbol_infos;
+        std::vector<uint32_t> command_list;
+        EXPECT_FALSE(JIT::translator::CompileExpression(expr, call_symbols, options, command_list));
+        return command_list;
+    };
+    auto count = [](const std::vector<uint32_t>& command_list, uint32_t command) {
+        return std::count(command_list.begin(), command_list.end(), command);
+    };
+
+    auto command_list = compile("f(1)", 0x200000);
+    auto call = std::find_if(command_list.begin(), command_list.end(), [](uint32_t command) {
+        return (command & 0xFF000000) == command_code::BranchLink(0);
+    });
+    ASSERT_NE(call, command_list.end());
+    uint32_t position = 0x200000 + 4 * (call - command_list.begin());
+    EXPECT_EQ(*call, command_code::BranchLink(0x100000 - position - 8));
+    EXPECT_EQ(count(compile("f(1)", 0), command_code::BranchLinkExchange(command_code::R12)), 1);
+
+    // Repeated callee out of reach is kept in r11
+    command_list = compile("g(1)+g(2)", 0x200000);
+    EXPECT_EQ(count(command_list, command_code::BranchLinkExchange(11)), 2);
+    EXPECT_EQ(count(command_list, command_code::BranchLinkExchange(command_code::R12)), 0);
+    EXPECT_EQ(count(compile("g(1)", 0x200000), command_code::BranchLinkExchange(command_code::R12)), 1);
+
+    // Argument registers are zeroed only if the callee may read them
+    uint32_t zero_r1 = command_code::DataImmediate(command_code::MOV, 1, 0, 0);
+    symbol_info_t infos[] = {{"f", 1, JIT_IMPURE, 0}, {nullptr, 0, 0, 0}};
+    EXPECT_EQ(count(compile("f(1)", 0), zero_r1), 1);
+    EXPECT_EQ(count(compile("f(1)", 0, infos), zero_r1), 0);
+}
+
+TEST(OptimizingCompiler, Timings) {
+    std::vector<JIT::optimizer::PassTiming> timings;
+    JIT::translator::CompileOptions options;
+    options.timings = &timings;
+    std::vector<uint32_t> command_list;
+    EXPECT_FALSE(JIT::translator::CompileExpression("a*b+3", symbols, options, command_list));
+
+    std::vector<std::string> names;
+    for (const auto& timing : timings) {
+        names.push_back(timing.name);
+    }
+    EXPECT_EQ(names.front(), "parse");
+    EXPECT_EQ(names[1], "build");
+    EXPECT_NE(std::find(names.begin(), names.end(), "dce"), names.end());
+    EXPECT_EQ(names.back(), "codegen");
+
+    command_list.resize(1024);
+    jit_pass_timing_t c_timings[2];
+    jit_options_t c_options = {0, c_timings, 2, 0, 0, nullptr, 0, 0};
+    EXPECT_EQ(jit_compile_expression_to_arm_with_options("a*b+3", symbols, command_list.data(),
+                                                         &c_options, nullptr), 1);
+    EXPECT_EQ(c_options.num_timings, 2);
+    EXPECT_STREQ(c_timings[1].name, "codegen");
+}
+
+TEST(OptimizingCompiler, SameCodeAtO0) {
+    JIT::translator::CompileOptions options;
+    options.optimizer.level = JIT::optimizer::OptimizationLevel::O0;
+    std::vector<uint32_t> command_list;
+    EXPECT_FALSE(JIT::translator::CompileExpression("sum(2+3*dec(d), a)-(-c)", symbols, options,
+                                                    command_list));
+    std::vector<uint32_t> expected = CompileToCommandList("sum(2+3*dec(d), a)-(-c)");
+    JIT::translator::OptimizePeephole(expected);
+    EXPECT_EQ(command_list, expected);
+}
+
+TEST(Peephole, Patterns) {
+    namespace command_code = JIT::translator::command_code;
+    std::vector<uint32_t> command_list = {
+        command_code::PUSH_R0, command_code::POP[0],
+        command_code::MoveWide(1, 0), command_code::PUSH_R0, command_code::POP[2], command_code::MoveTop(1, 0),
+        command_code::MoveWide(3, 0), command_code::MoveTop(3, 0),
+        command_code::MoveWide(3, 1), command_code::MoveTop(3, 0),
+        command_code::Pop(0x4010), command_code::BX_LR
+    };
+    EXPECT_EQ(JIT::translator::OptimizePeephole(command_list), 5);
+    std::vector<uint32_t> expected = {
+        command_code::MoveWide(1, 0), command_code::DataRegister(command_code::MOV, 2, 0, 0),
+        command_code::MoveTop(1, 0), command_code::DataImmediate(command_code::MOV, 3, 0, 0),
+        command_code::MoveWide(3, 1), command_code::MoveTop(3, 0), command_code::Pop(0x8010)
+    };
+    EXPECT_EQ(command_list, expected);
+
+    // Pairs are found after removal of the ones between them
+    command_list = {command_code::PUSH_R0, command_code::PUSH_R0, command_code::POP[0], command_code::POP[1]};
+    EXPECT_EQ(JIT::translator::OptimizePeephole(command_list), 3);
+    EXPECT_EQ(command_list, std::vector<uint32_t>{command_code::DataRegister(command_code::MOV, 1, 0, 0)});
+
+    uint32_t buffer[1024];
+    jit_options_t options = {0, nullptr, 0, 0, 0, nullptr, 0, 0};
+    jit_error_t error;
+    EXPECT_EQ(jit_compile_expression_to_arm_with_options("a+b", symbols, buffer, &options, &error), 1);
+    EXPECT_GT(options.num_removed_commands, 0);
+    // Generated code has nothing to remove, the count from before is reset
+    options.optimization_level = 2;
+    EXPECT_EQ(jit_compile_expression_to_arm_with_options("a+b", symbols, buffer, &options, &error), 1);
+    EXPECT_EQ(options.num_removed_commands, 0);
+}
+
+TEST(OptimizingCompiler, Errors) {
+    uint32_t command_list[1024];
+    jit_options_t options = {2, nullptr, 0, 0, 0, nullptr, 0, 0};
+    jit_error_t error;
+    EXPECT_EQ(jit_compile_expression_to_arm_with_options("a * e", symbols, command_list,
+                                                         &options, &error), 0);
+    EXPECT_EQ(error.kind, static_cast<int>(JIT::parser::ErrorKind::UNDEFINED_SYMBOL));
+    EXPECT_EQ(error.position, 4);
+}
+
+TEST(OptimizingCompiler, Corectness) {
+    for (int level = 0; level <= 3; ++level) {
+        static int optimization_level;
+        optimization_level = level;
+        compiler_t compiler = [](const char* expression, const symbol_t* externs, void* out_buffer) {
+            jit_options_t options = {optimization_level, nullptr, 0, 0, 0, nullptr, 0, 0};
+            return jit_compile_expression_to_arm_with_options(expression, externs, out_buffer,
+                                                              &options, nullptr);
+        };
+        EXPECT_EQ(Execute("sum(2+3*dec(d), a)-(-c)", compiler), 718);
+        EXPECT_EQ(Execute("(a+b)*(c-d)*-(a*b*c*d+1)-dec(dec(dec(a)))", compiler), 240);
+    }
+
+    for (int level = 2; level <= 3; ++level) {
+        static int optimization_level;
+        optimization_level = level;
+        compiler_t compiler = [](const char* expression, const symbol_t* externs, void* out_buffer) {
+            static const symbol_info_t symbol_infos[] = {
+                {"sum", 3, JIT_CONST, 10},
+                {"dec", 1, JIT_PURE, 5},
+                {nullptr, 0, JIT_IMPURE, 0}
+            };
+            jit_options_t options = {optimization_level, nullptr, 0, 0, 0, symbol_infos, 0, 0};
+            return jit_compile_expression_to_arm_with_options(expression, externs, out_buffer,
+                                                              &options, nullptr);
+        };
+        EXPECT_EQ(Execute("sum(2+3*dec(d), a, 1)-(-c)*sum(1, 2, 3)", compiler), 729);
+    }
+}
+
 int main(int argc, char* argv[]) {
     testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
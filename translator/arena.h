@@ -0,0 +1,41 @@
+#ifndef ARENA_H_
+#define ARENA_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+namespace JIT {
+    namespace translator {
+        // Bump allocator over a caller-supplied buffer. Nothing is freed
+        // separately: memory is released all at once with the buffer
+        class Arena {
+        public:
+            Arena(void* buffer, size_t size)
+                : begin_(static_cast<char*>(buffer)), size_(size) {
+            }
+
+            template <class T>
+            T* Allocate(size_t count) {
+                uintptr_t begin = reinterpret_cast<uintptr_t>(begin_);
+                uintptr_t position = (begin + used_ + alignof(T) - 1) & ~(alignof(T) - 1);
+                if (position + count * sizeof(T) > begin + size_) {
+                    throw std::bad_alloc();
+                }
+                used_ = position + count * sizeof(T) - begin;
+                return reinterpret_cast<T*>(position);
+            }
+
+            size_t Used() const {
+                return used_;
+            }
+
+        private:
+            char* begin_;
+            size_t size_;
+            size_t used_ = 0;
+        };
+    } // namespace translator
+} // namespace JIT
+
+#endif // ARENA_H_
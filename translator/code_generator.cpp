@@ -0,0 +1,628 @@
+#include "translator/code_generator.h"
+
+#include <algorithm>
+
+#include "translator/commands.h"
+#include "translator/strength_reduction.h"
+
+namespace JIT {
+    namespace translator {
+        using optimizer::MULTIPLY_COST;
+        using optimizer::Opcode;
+        using optimizer::ValueId;
+
+        constexpr uint32_t NO_SLOT = UINT32_MAX;
+        constexpr uint32_t NO_REGISTER = UINT32_MAX;
+        constexpr uint32_t NUM_REGISTER_ARGUMENTS = 4;
+        // Values live in callee-saved r4-r11, so they survive calls. r0-r3 and r12
+        // are scratch for constants, spilled operands, call arguments and targets
+        constexpr uint32_t FIRST_VALUE_REGISTER = 4;
+        constexpr uint32_t NUM_VALUE_REGISTERS = 8;
+        // ldr takes offsets below 4096. A base register costs movw and movt once and
+        // a register, each load relative to it saves them. It is taken only if
+        // values live at once fit in the other registers, as are callee registers
+        constexpr uint32_t MAX_LOAD_OFFSET = 4096;
+        constexpr uint32_t MIN_BASE_LOADS = 2;
+        // Callees out of reach of bl called this many times keep their address in
+        // a register, as long as enough registers are left for values
+        constexpr uint32_t MIN_CALLEE_CALLS = 2;
+        constexpr uint32_t MAX_CALLEE_REGISTERS = 2;
+
+        // Instruction covering one or more IR instructions, chosen by patterns over
+        // the DAG. Operands not in registers are put to r0, r1 and r2 in order
+        struct Tile {
+            enum Kind : uint8_t {
+                NONE, // Constant or covered by the tile of its user
+                LOAD,
+                CALL,
+                DATA, // operation r0, r0, r1, lsl #shift
+                DATA_IMMEDIATE, // operation r0, r0, #immediate
+                MULTIPLY,
+                MULTIPLY_ACCUMULATE, // r0 * r1 + r2
+                MULTIPLY_SUBTRACT, // r2 - r0 * r1
+                MULTIPLY_BY_SEQUENCE
+            } kind = NONE;
+            command_code::DataOperation operation = command_code::ADD;
+            uint32_t shift = 0;
+            uint32_t immediate = 0; // Encoded by EncodeImmediate
+            std::vector<ValueId> operands;
+            std::vector<MultiplicationStep> sequence;
+        };
+
+        class CodeGenerator {
+        public:
+            CodeGenerator(const optimizer::Function& function, uint32_t code_address,
+                          std::vector<uint32_t>& command_list)
+                : function_(function), code_address_(code_address), command_list_(command_list) {
+            }
+
+            void Generate() {
+                SelectTiles();
+                ComputeLiveness();
+                SelectBase();
+                SelectCallees();
+                AllocateRegisters();
+                AssignSlots();
+                command_list_.push_back(command_code::Push(saved_registers_));
+                AdjustStack(command_code::SUB);
+                if (base_register_ != NO_REGISTER) {
+                    MoveConstant(base_register_, base_address_);
+                }
+                for (const auto& [address, reg] : callee_registers_) {
+                    MoveConstant(reg, address);
+                }
+                for (ValueId value = 0; value < function_.Size(); ++value) {
+                    if (tiles_[value].kind == Tile::NONE) {
+                        // Constants are set right where they are used
+                        continue;
+                    }
+                    // Spilled values are computed to r0 and stored
+                    uint32_t reg = registers_[value] != NO_REGISTER ? registers_[value] : 0;
+                    Compute(function_[value], tiles_[value], reg);
+                    if (slots_[value] != NO_SLOT) {
+                        AccessSlot(true, reg, slots_[value]);
+                    }
+                }
+                if (!is_result_in_r0_) {
+                    Materialize(function_.result, 0);
+                }
+                AdjustStack(command_code::ADD);
+                // Return by popping lr to pc
+                command_list_.push_back(command_code::Pop(saved_registers_ ^ (1u << command_code::LR) ^
+                                                          (1u << command_code::PC)));
+            }
+
+        private:
+            // Tiles are chosen in order, a tile may cover operands with tiles chosen
+            // before, if it is their only user
+            void SelectTiles() {
+                num_uses_.assign(function_.Size(), 0);
+                for (const auto& instruction : function_.instructions) {
+                    for (ValueId operand : instruction.operands) {
+                        ++num_uses_[operand];
+                    }
+                }
+                ++num_uses_[function_.result];
+
+                tiles_.assign(function_.Size(), Tile());
+                for (ValueId value = 0; value < function_.Size(); ++value) {
+                    const auto& instruction = function_[value];
+                    auto& tile = tiles_[value];
+                    switch (instruction.opcode) {
+                    case Opcode::CONSTANT:
+                        break;
+
+                    case Opcode::LOAD:
+                        tile.kind = Tile::LOAD;
+                        break;
+
+                    case Opcode::CALL:
+                        tile.kind = Tile::CALL;
+                        tile.operands = instruction.operands;
+                        break;
+
+                    case Opcode::NEG:
+                        // rsb r0, r0, #0
+                        tile.kind = Tile::DATA_IMMEDIATE;
+                        tile.operation = command_code::RSB;
+                        tile.operands = instruction.operands;
+                        break;
+
+                    case Opcode::MUL:
+                        SelectMultiply(instruction, tile);
+                        break;
+
+                    default:
+                        SelectAddSub(instruction, tile);
+                        break;
+                    }
+                }
+            }
+
+            bool IsConstant(ValueId value) const {
+                return function_[value].opcode == Opcode::CONSTANT;
+            }
+
+            void SelectMultiply(const optimizer::Instruction& instruction, Tile& tile) {
+                ValueId factor = instruction.operands[0], multiplier = instruction.operands[1];
+                if (IsConstant(factor)) {
+                    std::swap(factor, multiplier);
+                }
+                // Steps take a cycle each, setting the constant for mul one per command
+                if (IsConstant(multiplier) &&
+                    FindMultiplicationSequence(function_[multiplier].constant, tile.sequence) &&
+                    tile.sequence.size() < GetConstantSize(function_[multiplier].constant) + MULTIPLY_COST) {
+                    tile.kind = Tile::MULTIPLY_BY_SEQUENCE;
+                    tile.operands = {factor};
+                    return;
+                }
+                tile.kind = Tile::MULTIPLY;
+                tile.operands = instruction.operands;
+            }
+
+            // x << shift used once, which fits a shifted operand
+            bool IsShift(ValueId value, ValueId& x, uint32_t& shift) const {
+                const auto& tile = tiles_[value];
+                if (num_uses_[value] != 1 || tile.kind != Tile::MULTIPLY_BY_SEQUENCE ||
+                    tile.sequence.size() != 1 || tile.sequence[0].kind != MultiplicationStep::SHIFT) {
+                    return false;
+                }
+                x = tile.operands[0];
+                shift = tile.sequence[0].shift;
+                return true;
+            }
+
+            // Product used once, which fits mla and mls
+            bool IsProduct(ValueId value) const {
+                return num_uses_[value] == 1 && tiles_[value].kind == Tile::MULTIPLY;
+            }
+
+            void SelectAddSub(const optimizer::Instruction& instruction, Tile& tile) {
+                bool is_add = instruction.opcode == Opcode::ADD;
+                ValueId left = instruction.operands[0], right = instruction.operands[1];
+                tile.operation = is_add ? command_code::ADD : command_code::SUB;
+                command_code::DataOperation opposite = is_add ? command_code::SUB : command_code::ADD;
+
+                // x + #c, x - #c and #c - x
+                if (is_add && IsConstant(left)) {
+                    std::swap(left, right);
+                }
+                if (IsConstant(right)) {
+                    uint32_t constant = function_[right].constant;
+                    tile.kind = Tile::DATA_IMMEDIATE;
+                    tile.operands = {left};
+                    if (command_code::EncodeImmediate(constant, tile.immediate)) {
+                        return;
+                    }
+                    if (command_code::EncodeImmediate(0u - constant, tile.immediate)) {
+                        tile.operation = opposite;
+                        return;
+                    }
+                    tile.kind = Tile::NONE;
+                }
+                if (!is_add && IsConstant(left) &&
+                    command_code::EncodeImmediate(function_[left].constant, tile.immediate)) {
+                    tile.kind = Tile::DATA_IMMEDIATE;
+                    tile.operation = command_code::RSB;
+                    tile.operands = {right};
+                    return;
+                }
+
+                // x + (y << shift), x - (y << shift) and (y << shift) - x
+                ValueId shifted = 0;
+                if (is_add && IsShift(left, shifted, tile.shift)) {
+                    std::swap(left, right);
+                }
+                if (IsShift(right, shifted, tile.shift)) {
+                    tiles_[right].kind = Tile::NONE;
+                    tile.kind = Tile::DATA;
+                    tile.operands = {left, shifted};
+                    return;
+                }
+                if (!is_add && IsShift(left, shifted, tile.shift)) {
+                    tiles_[left].kind = Tile::NONE;
+                    tile.kind = Tile::DATA;
+                    tile.operation = command_code::RSB;
+                    tile.operands = {right, shifted};
+                    return;
+                }
+
+                // mla and mls
+                if (is_add && IsProduct(left)) {
+                    std::swap(left, right);
+                }
+                if (IsProduct(right)) {
+                    tiles_[right].kind = Tile::NONE;
+                    tile.kind = is_add ? Tile::MULTIPLY_ACCUMULATE : Tile::MULTIPLY_SUBTRACT;
+                    tile.operands = {function_[right].operands[0], function_[right].operands[1], left};
+                    return;
+                }
+
+                tile.kind = Tile::DATA;
+                tile.shift = 0;
+                tile.operands = {left, right};
+            }
+
+            // Variables are loaded relative to a base register set once, if enough of
+            // them are close to each other. The base takes the last value register
+            void SelectBase() {
+                std::vector<uint32_t> addresses;
+                for (ValueId value = 0; value < function_.Size(); ++value) {
+                    if (tiles_[value].kind == Tile::LOAD) {
+                        addresses.push_back(reinterpret_cast<uint32_t>(function_[value].symbol));
+                    }
+                }
+                std::sort(addresses.begin(), addresses.end());
+                // Window of addresses reachable from its first one with most loads
+                uint32_t num_base_loads = 0;
+                for (uint32_t begin = 0, end = 0; begin < addresses.size(); ++begin) {
+                    while (end < addresses.size() && addresses[end] - addresses[begin] < MAX_LOAD_OFFSET) {
+                        ++end;
+                    }
+                    if (end - begin > num_base_loads) {
+                        num_base_loads = end - begin;
+                        base_address_ = addresses[begin];
+                    }
+                }
+                if (num_base_loads >= MIN_BASE_LOADS && CanPinRegister()) {
+                    base_register_ = TakePinnedRegister();
+                }
+            }
+
+            // Calls take bl if the callee is in reach from the start of the code, so
+            // only the other ones repeated enough get registers, most called first
+            void SelectCallees() {
+                std::vector<uint32_t> addresses;
+                for (ValueId value = 0; value < function_.Size(); ++value) {
+                    uint32_t address = reinterpret_cast<uint32_t>(function_[value].symbol);
+                    if (tiles_[value].kind == Tile::CALL && !IsReachable(address, code_address_)) {
+                        addresses.push_back(address);
+                    }
+                }
+                std::sort(addresses.begin(), addresses.end());
+                std::vector<std::pair<uint32_t, uint32_t>> counts; // Number of calls and address
+                for (auto it = addresses.begin(); it != addresses.end();) {
+                    auto end = std::upper_bound(it, addresses.end(), *it);
+                    if (static_cast<uint32_t>(end - it) >= MIN_CALLEE_CALLS) {
+                        counts.push_back({end - it, *it});
+                    }
+                    it = end;
+                }
+                std::sort(counts.rbegin(), counts.rend());
+                for (uint32_t i = 0; i < counts.size() && i < MAX_CALLEE_REGISTERS && CanPinRegister(); ++i) {
+                    callee_registers_.push_back({counts[i].second, TakePinnedRegister()});
+                }
+            }
+
+            // Values live at once still fit in the rest of registers
+            bool CanPinRegister() const {
+                return max_live_values_ < num_value_registers_;
+            }
+
+            // Last value register, holding a constant through the whole function
+            uint32_t TakePinnedRegister() {
+                --num_value_registers_;
+                return FIRST_VALUE_REGISTER + num_value_registers_;
+            }
+
+            bool IsReachable(uint32_t address, uint32_t from) const {
+                return code_address_ != 0 &&
+                       command_code::IsBranchLinkReachable(static_cast<int32_t>(address - from - 8));
+            }
+
+            // Last uses of values and the most of them live at once
+            void ComputeLiveness() {
+                last_uses_.assign(function_.Size(), 0);
+                ValueId last_computed = 0;
+                for (ValueId value = 0; value < function_.Size(); ++value) {
+                    const auto& tile = tiles_[value];
+                    for (ValueId operand : tile.operands) {
+                        last_uses_[operand] = value;
+                    }
+                    if (tile.kind != Tile::NONE) {
+                        last_computed = value;
+                    }
+                    if (tile.kind == Tile::CALL && tile.operands.size() > NUM_REGISTER_ARGUMENTS) {
+                        num_stack_arguments_ = std::max<uint32_t>(
+                            num_stack_arguments_, tile.operands.size() - NUM_REGISTER_ARGUMENTS);
+                    }
+                }
+                // Result computed last and used by nothing else goes straight to r0
+                is_result_in_r0_ = function_.result == last_computed && num_uses_[function_.result] == 1 &&
+                                   tiles_[function_.result].kind != Tile::NONE;
+                if (!is_result_in_r0_) {
+                    last_uses_[function_.result] = function_.Size();
+                }
+
+                // Operands are freed at their last use before the value takes a register
+                std::vector<int32_t> changes(function_.Size() + 1, 0);
+                for (ValueId value = 0; value < function_.Size(); ++value) {
+                    if (tiles_[value].kind != Tile::NONE && last_uses_[value] > value) {
+                        ++changes[value];
+                        --changes[last_uses_[value]];
+                    }
+                }
+                int32_t num_live_values = 0;
+                for (int32_t change : changes) {
+                    num_live_values += change;
+                    max_live_values_ = std::max<uint32_t>(max_live_values_, num_live_values);
+                }
+            }
+
+            // Linear scan over values in order: a value takes a free register from
+            // its definition to its last use. If there is none, the value living
+            // longest of it and the ones in registers is spilled to a stack slot
+            void AllocateRegisters() {
+                registers_.assign(function_.Size(), NO_REGISTER);
+                std::vector<ValueId> owners(num_value_registers_, NO_REGISTER);
+                // Pinned registers are above the ones for values
+                uint32_t used_registers = ((1u << (FIRST_VALUE_REGISTER + NUM_VALUE_REGISTERS)) - 1) &
+                                          ~((1u << (FIRST_VALUE_REGISTER + num_value_registers_)) - 1);
+                for (ValueId value = 0; value < function_.Size(); ++value) {
+                    for (ValueId operand : tiles_[value].operands) {
+                        if (last_uses_[operand] == value && registers_[operand] != NO_REGISTER) {
+                            owners[registers_[operand] - FIRST_VALUE_REGISTER] = NO_REGISTER;
+                        }
+                    }
+                    if (tiles_[value].kind == Tile::NONE || last_uses_[value] <= value) {
+                        continue;
+                    }
+                    auto free = std::find(owners.begin(), owners.end(), NO_REGISTER);
+                    if (free == owners.end()) {
+                        free = std::max_element(owners.begin(), owners.end(), [this](ValueId left, ValueId right) {
+                            return last_uses_[left] < last_uses_[right];
+                        });
+                        if (last_uses_[*free] <= last_uses_[value]) {
+                            continue;
+                        }
+                        registers_[*free] = NO_REGISTER;
+                    }
+                    *free = value;
+                    registers_[value] = FIRST_VALUE_REGISTER + (free - owners.begin());
+                    used_registers |= 1u << registers_[value];
+                }
+
+                // Stack stays 8 byte aligned with an even number of registers saved
+                saved_registers_ = used_registers | (1u << command_code::LR);
+                if (__builtin_popcount(saved_registers_) % 2 != 0) {
+                    uint32_t pad = FIRST_VALUE_REGISTER;
+                    while (pad < FIRST_VALUE_REGISTER + NUM_VALUE_REGISTERS && (used_registers >> pad) % 2 != 0) {
+                        ++pad;
+                    }
+                    saved_registers_ |= 1u << pad;
+                }
+            }
+
+            // Spilled values used after their definition get slots, which are reused
+            // after the last use of their value
+            void AssignSlots() {
+                std::vector<ValueId> last_uses = last_uses_;
+                slots_.assign(function_.Size(), NO_SLOT);
+                std::vector<uint32_t> free_slots;
+                for (ValueId value = 0; value < function_.Size(); ++value) {
+                    for (ValueId operand : tiles_[value].operands) {
+                        if (last_uses[operand] == value && slots_[operand] != NO_SLOT) {
+                            free_slots.push_back(slots_[operand]);
+                            // Operand may repeat
+                            last_uses[operand] = 0;
+                        }
+                    }
+                    if (tiles_[value].kind == Tile::NONE || last_uses[value] <= value ||
+                        registers_[value] != NO_REGISTER) {
+                        continue;
+                    }
+                    if (free_slots.empty()) {
+                        free_slots.push_back(num_slots_++);
+                    }
+                    slots_[value] = free_slots.back();
+                    free_slots.pop_back();
+                }
+                // Stack stays 8 byte aligned
+                frame_size_ = (4 * (num_stack_arguments_ + num_slots_) + 7) & ~7u;
+            }
+
+            // Outgoing call arguments are at the bottom of the frame
+            uint32_t SlotOffset(uint32_t slot) const {
+                return 4 * (num_stack_arguments_ + slot);
+            }
+
+            void AdjustStack(command_code::DataOperation operation) {
+                if (frame_size_ == 0) {
+                    return;
+                }
+                uint32_t immediate = 0;
+                if (command_code::EncodeImmediate(frame_size_, immediate)) {
+                    command_list_.push_back(command_code::DataImmediate(operation, command_code::SP,
+                                                                        command_code::SP, immediate));
+                } else {
+                    MoveConstant(command_code::R12, frame_size_);
+                    command_list_.push_back(command_code::DataRegister(operation, command_code::SP,
+                                                                       command_code::SP, command_code::R12));
+                }
+            }
+
+            // str/ldr reg, [sp, #offset], far offsets go through r12
+            void AccessStack(bool store, uint32_t reg, uint32_t offset) {
+                if (offset < 4096) {
+                    command_list_.push_back(store ? command_code::StoreImmediate(reg, command_code::SP, offset)
+                                                  : command_code::LoadImmediate(reg, command_code::SP, offset));
+                } else {
+                    MoveConstant(command_code::R12, offset);
+                    command_list_.push_back(store ? command_code::StoreRegister(reg, command_code::SP, command_code::R12)
+                                                  : command_code::LoadRegister(reg, command_code::SP, command_code::R12));
+                }
+            }
+
+            void AccessSlot(bool store, uint32_t reg, uint32_t slot) {
+                AccessStack(store, reg, SlotOffset(slot));
+            }
+
+            void MoveConstant(uint32_t reg, uint32_t constant) {
+                SetConstant(command_list_, reg, constant);
+            }
+
+            // Puts the value to the register
+            void Materialize(ValueId value, uint32_t reg) {
+                const auto& instruction = function_[value];
+                if (instruction.opcode == Opcode::CONSTANT) {
+                    MoveConstant(reg, instruction.constant);
+                } else if (registers_[value] == NO_REGISTER) {
+                    AccessSlot(false, reg, slots_[value]);
+                } else if (registers_[value] != reg) {
+                    command_list_.push_back(command_code::DataRegister(command_code::MOV, reg, 0, registers_[value]));
+                }
+            }
+
+            // Register holding the operand, scratch one if it is not in a register
+            uint32_t Use(ValueId value, uint32_t scratch) {
+                if (registers_[value] != NO_REGISTER) {
+                    return registers_[value];
+                }
+                Materialize(value, scratch);
+                return scratch;
+            }
+
+            // Multiplies x by shifts, additions and subtractions, r1 keeps
+            // intermediate results
+            void MultiplyBySequence(const std::vector<MultiplicationStep>& sequence, uint32_t rd, uint32_t x) {
+                if (sequence.empty() && rd != x) {
+                    command_list_.push_back(command_code::DataRegister(command_code::MOV, rd, 0, x));
+                }
+                for (uint32_t i = 0; i < sequence.size(); ++i) {
+                    const auto& step = sequence[i];
+                    uint32_t target = (i + 1 == sequence.size() ? rd : 1),
+                             rn = (step.left == StepOperand::X ? x : 1),
+                             rm = (step.right == StepOperand::X ? x : 1);
+                    switch (step.kind) {
+                    case MultiplicationStep::SHIFT:
+                        command_list_.push_back(command_code::DataRegister(
+                            command_code::MOV, target, 0, rn, command_code::LSL, step.shift));
+                        break;
+
+                    case MultiplicationStep::NEGATE:
+                        command_list_.push_back(command_code::DataImmediate(command_code::RSB, target, rn, 0));
+                        break;
+
+                    default:
+                        command_list_.push_back(command_code::DataRegister(
+                            step.kind == MultiplicationStep::ADD ? command_code::ADD :
+                            step.kind == MultiplicationStep::SUB ? command_code::SUB : command_code::RSB,
+                            target, rn, rm, command_code::LSL, step.shift));
+                        break;
+                    }
+                }
+            }
+
+            // bl if the callee is in reach, blx otherwise
+            void Call(uint32_t address) {
+                uint32_t position = code_address_ + 4 * command_list_.size();
+                if (IsReachable(address, position)) {
+                    command_list_.push_back(command_code::BranchLink(static_cast<int32_t>(address - position - 8)));
+                    return;
+                }
+                for (const auto& [callee, reg] : callee_registers_) {
+                    if (callee == address) {
+                        command_list_.push_back(command_code::BranchLinkExchange(reg));
+                        return;
+                    }
+                }
+                MoveConstant(command_code::R12, address);
+                command_list_.push_back(command_code::BranchLinkExchange(command_code::R12));
+            }
+
+            // Computes the tile to rd
+            void Compute(const optimizer::Instruction& instruction, const Tile& tile, uint32_t rd) {
+                const auto& operands = tile.operands;
+                if (tile.kind == Tile::LOAD) {
+                    uint32_t address = reinterpret_cast<uint32_t>(instruction.symbol);
+                    if (base_register_ != NO_REGISTER && address - base_address_ < MAX_LOAD_OFFSET) {
+                        command_list_.push_back(command_code::LoadImmediate(rd, base_register_,
+                                                                            address - base_address_));
+                        return;
+                    }
+                    MoveConstant(rd, address);
+                    command_list_.push_back(command_code::LoadImmediate(rd, rd, 0));
+                    return;
+                }
+                if (tile.kind == Tile::CALL) {
+                    for (uint32_t i = NUM_REGISTER_ARGUMENTS; i < operands.size(); ++i) {
+                        AccessStack(true, Use(operands[i], 0), 4 * (i - NUM_REGISTER_ARGUMENTS));
+                    }
+                    // Values are never in r0-r3, so arguments don't overwrite each other
+                    for (uint32_t i = 0; i < NUM_REGISTER_ARGUMENTS; ++i) {
+                        if (i < operands.size()) {
+                            Materialize(operands[i], i);
+                        } else if (instruction.info.arity < 0) {
+                            // Missing arguments are zero as in GetARMCommandList, unless
+                            // the callee is known to take no more
+                            command_list_.push_back(command_code::DataImmediate(command_code::MOV, i, 0, 0));
+                        }
+                    }
+                    Call(reinterpret_cast<uint32_t>(instruction.symbol));
+                    if (rd != 0) {
+                        command_list_.push_back(command_code::DataRegister(command_code::MOV, rd, 0, 0));
+                    }
+                    return;
+                }
+
+                uint32_t registers[3] = {};
+                for (uint32_t i = 0; i < operands.size(); ++i) {
+                    registers[i] = Use(operands[i], i);
+                }
+                switch (tile.kind) {
+                case Tile::DATA:
+                    command_list_.push_back(command_code::DataRegister(tile.operation, rd, registers[0], registers[1],
+                                                                       command_code::LSL, tile.shift));
+                    break;
+
+                case Tile::DATA_IMMEDIATE:
+                    command_list_.push_back(command_code::DataImmediate(tile.operation, rd, registers[0],
+                                                                        tile.immediate));
+                    break;
+
+                case Tile::MULTIPLY:
+                    command_list_.push_back(command_code::Multiply(rd, registers[0], registers[1]));
+                    break;
+
+                case Tile::MULTIPLY_ACCUMULATE:
+                    command_list_.push_back(command_code::MultiplyAccumulate(rd, registers[0], registers[1],
+                                                                             registers[2]));
+                    break;
+
+                case Tile::MULTIPLY_SUBTRACT:
+                    command_list_.push_back(command_code::MultiplySubtract(rd, registers[0], registers[1],
+                                                                           registers[2]));
+                    break;
+
+                default:
+                    MultiplyBySequence(tile.sequence, rd, registers[0]);
+                    break;
+                }
+            }
+
+            const optimizer::Function& function_;
+            uint32_t code_address_; // Zero if unknown
+            std::vector<uint32_t>& command_list_;
+            std::vector<uint32_t> num_uses_;
+            std::vector<Tile> tiles_;
+            std::vector<ValueId> last_uses_;
+            std::vector<uint32_t> registers_;
+            std::vector<uint32_t> slots_;
+            uint32_t num_slots_ = 0;
+            uint32_t num_stack_arguments_ = 0;
+            uint32_t frame_size_ = 0;
+            uint32_t saved_registers_ = 0; // Mask for push and pop
+            uint32_t num_value_registers_ = NUM_VALUE_REGISTERS;
+            uint32_t max_live_values_ = 0;
+            uint32_t base_register_ = NO_REGISTER;
+            uint32_t base_address_ = 0;
+            std::vector<std::pair<uint32_t, uint32_t>> callee_registers_; // Address and register
+            bool is_result_in_r0_ = false;
+        };
+
+        void GenerateCode(const optimizer::Function& function, uint32_t code_address,
+                          std::vector<uint32_t>& command_list) {
+            CodeGenerator(function, code_address, command_list).Generate();
+        }
+    } // namespace translator
+} // namespace JIT
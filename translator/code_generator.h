@@ -0,0 +1,21 @@
+#ifndef CODE_GENERATOR_H_
+#define CODE_GENERATOR_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "optimizer/ir.h"
+
+namespace JIT {
+    namespace translator {
+        // Translates the function to ARM code with the calling convention of
+        // GetARMCommandList. Values live in callee-saved registers between their
+        // uses and are spilled to stack frame slots when those run out. Variables
+        // close to each other are loaded relative to a base register. If the address
+        // the code runs at is known (nonzero), callees in reach are called by bl
+        void GenerateCode(const optimizer::Function& function, uint32_t code_address,
+                          std::vector<uint32_t>& command_list);
+    } // namespace translator
+} // namespace JIT
+
+#endif // CODE_GENERATOR_H_
@@ -0,0 +1,414 @@
+#ifndef COMMANDS_H_
+#define COMMANDS_H_
+
+#include <cstdint>
+#include <initializer_list>
+
+#include "parser/parser.h"
+
+namespace JIT {
+    namespace translator {
+        // ARM assembler code codes
+        namespace command_code {
+            constexpr uint32_t ADD_R0_R0_R1 = 0xE0800001;
+            constexpr uint32_t SUB_R0_R0_R1 = 0xE0400001;
+            constexpr uint32_t MUL_R0_R0_R1 = 0xE0000190;
+            constexpr uint32_t PUSH_R0 = 0xE52D0004;
+            // Commands like pop {ri}
+            constexpr uint32_t POP[4] = {
+                0xE49D0004,
+                0xE49D1004,
+                0xE49D2004,
+                0xE49D3004
+            };
+            // Commands like movw ri, #0
+            constexpr uint32_t MOVW[5] = {
+                0xE3000000,
+                0xE3001000,
+                0xE3002000,
+                0xE3003000,
+                0xE3004000
+            };
+            // Commands like movt ri, #0
+            constexpr uint32_t MOVT[5] = {
+                0xE3400000,
+                0xE3401000,
+                0xE3402000,
+                0xE3403000,
+                0xE3404000
+            };
+            // Commands like ldr ri, [ri]
+            constexpr uint32_t LDR[5] = {
+                0xE5900000,
+                0xE5911000,
+                0xE5922000,
+                0xE5933000,
+                0xE5944000
+            };
+            constexpr uint32_t BLX_R4 = 0xE12FFF34;
+            constexpr uint32_t PUSH_R4_LR = 0xE92D4010;
+            constexpr uint32_t POP_R4_LR = 0xE8BD4010;
+            constexpr uint32_t BX_LR = 0xE12FFF1E;
+
+            // Encoders of commands with any registers
+
+            constexpr uint32_t R12 = 12;
+            constexpr uint32_t SP = 13;
+            constexpr uint32_t LR = 14;
+            constexpr uint32_t PC = 15;
+
+            // Data processing operations
+            enum DataOperation : uint32_t {
+                AND = 0x0,
+                SUB = 0x2,
+                RSB = 0x3,
+                ADD = 0x4,
+                ORR = 0xC,
+                MOV = 0xD,
+                MVN = 0xF
+            };
+
+            enum ShiftType : uint32_t {
+                LSL = 0,
+                LSR = 1,
+                ASR = 2
+            };
+
+            // op rd, rn, rm, shift #amount
+            constexpr uint32_t DataRegister(DataOperation operation, uint32_t rd, uint32_t rn, uint32_t rm,
+                                            ShiftType shift = LSL, uint32_t amount = 0) {
+                return 0xE0000000 | (operation << 21) | (rn << 16) | (rd << 12) |
+                       (amount << 7) | (shift << 5) | rm;
+            }
+
+            // op rd, rn, #imm where immediate is encoded by EncodeImmediate
+            constexpr uint32_t DataImmediate(DataOperation operation, uint32_t rd, uint32_t rn,
+                                             uint32_t immediate) {
+                return 0xE2000000 | (operation << 21) | (rn << 16) | (rd << 12) | immediate;
+            }
+
+            // Finds encoding of value as an 8-bit constant rotated right by an even
+            // number of bits
+            constexpr bool EncodeImmediate(uint32_t value, uint32_t& immediate) {
+                for (uint32_t rotation = 0; rotation < 32; rotation += 2) {
+                    // Rotate left to undo the rotation
+                    uint32_t base = rotation == 0 ? value : (value << rotation) | (value >> (32 - rotation));
+                    if (base < 256) {
+                        immediate = ((rotation / 2) << 8) | base;
+                        return true;
+                    }
+                }
+                return false;
+            }
+
+            // mul rd, rn, rm
+            constexpr uint32_t Multiply(uint32_t rd, uint32_t rn, uint32_t rm) {
+                return 0xE0000090 | (rd << 16) | (rm << 8) | rn;
+            }
+
+            // mla rd, rn, rm, ra: rd = rn * rm + ra
+            constexpr uint32_t MultiplyAccumulate(uint32_t rd, uint32_t rn, uint32_t rm, uint32_t ra) {
+                return 0xE0200090 | (rd << 16) | (ra << 12) | (rm << 8) | rn;
+            }
+
+            // mls rd, rn, rm, ra: rd = ra - rn * rm
+            constexpr uint32_t MultiplySubtract(uint32_t rd, uint32_t rn, uint32_t rm, uint32_t ra) {
+                return 0xE0600090 | (rd << 16) | (ra << 12) | (rm << 8) | rn;
+            }
+
+            // ldr rt, [rn, #offset] for offset below 4096
+            constexpr uint32_t LoadImmediate(uint32_t rt, uint32_t rn, uint32_t offset) {
+                return 0xE5900000 | (rn << 16) | (rt << 12) | offset;
+            }
+
+            // str rt, [rn, #offset] for offset below 4096
+            constexpr uint32_t StoreImmediate(uint32_t rt, uint32_t rn, uint32_t offset) {
+                return 0xE5800000 | (rn << 16) | (rt << 12) | offset;
+            }
+
+            // ldr rt, [rn, rm]
+            constexpr uint32_t LoadRegister(uint32_t rt, uint32_t rn, uint32_t rm) {
+                return 0xE7900000 | (rn << 16) | (rt << 12) | rm;
+            }
+
+            // str rt, [rn, rm]
+            constexpr uint32_t StoreRegister(uint32_t rt, uint32_t rn, uint32_t rm) {
+                return 0xE7800000 | (rn << 16) | (rt << 12) | rm;
+            }
+
+            constexpr uint32_t MoveWide(uint32_t rd, uint16_t constant) {
+                return 0xE3000000 | (rd << 12) | (((constant >> 12) << 16) | (constant & 0xFFF));
+            }
+
+            constexpr uint32_t MoveTop(uint32_t rd, uint16_t constant) {
+                return 0xE3400000 | (rd << 12) | (((constant >> 12) << 16) | (constant & 0xFFF));
+            }
+
+            // blx rm
+            constexpr uint32_t BranchLinkExchange(uint32_t rm) {
+                return 0xE12FFF30 | rm;
+            }
+
+            // bl to pc + 8 + offset, offset is a multiple of 4 within 32 MB
+            constexpr uint32_t BranchLink(int32_t offset) {
+                return 0xEB000000 | ((static_cast<uint32_t>(offset) >> 2) & 0xFFFFFF);
+            }
+
+            constexpr bool IsBranchLinkReachable(int32_t offset) {
+                return offset % 4 == 0 && offset >= -(1 << 25) && offset < (1 << 25);
+            }
+
+            // push/pop of registers set as bits of the mask
+            constexpr uint32_t Push(uint32_t registers) {
+                return 0xE92D0000 | registers;
+            }
+
+            constexpr uint32_t Pop(uint32_t registers) {
+                return 0xE8BD0000 | registers;
+            }
+        } // namespace command_code
+
+        // Command list writing straight into the code buffer
+        class CommandWriter {
+        public:
+            constexpr explicit CommandWriter(uint32_t* out) : begin_(out), end_(out) {
+            }
+
+            constexpr void push_back(uint32_t command) {
+                *end_ = command;
+                ++end_;
+            }
+
+            constexpr void pop_back() {
+                --end_;
+            }
+
+            constexpr uint32_t size() const {
+                return end_ - begin_;
+            }
+
+        private:
+            uint32_t* begin_;
+            uint32_t* end_;
+        };
+
+        // Only counts commands, to size the code before writing it
+        class CommandCounter {
+        public:
+            constexpr void push_back(uint32_t) {
+                ++size_;
+            }
+
+            constexpr void pop_back() {
+                --size_;
+            }
+
+            constexpr uint32_t size() const {
+                return size_;
+            }
+
+        private:
+            uint32_t size_ = 0;
+        };
+
+        // Emitters below accept std::vector<uint32_t>, CommandWriter or CommandCounter
+        // as a command list. Those taking addresses as numbers are constexpr
+
+        constexpr uint32_t AdaptConstantToWrite(uint16_t constant) {
+            // separate four bits: 0xabcd -> 0xa0bcd
+            return ((constant >> 12) << 16) | (constant & ((1 << 12) - 1));
+        }
+
+        // Shortest way to set the constant: mov or mvn of a rotated 8-bit immediate,
+        // a single movw if the top half is zero, movw and movt otherwise
+        template <class CommandList>
+        constexpr void SetConstant(CommandList& command_list, uint32_t reg_number, uint32_t constant) {
+            uint32_t immediate = 0;
+            if (command_code::EncodeImmediate(constant, immediate)) {
+                command_list.push_back(command_code::DataImmediate(command_code::MOV, reg_number, 0, immediate));
+            } else if (command_code::EncodeImmediate(~constant, immediate)) {
+                command_list.push_back(command_code::DataImmediate(command_code::MVN, reg_number, 0, immediate));
+            } else {
+                command_list.push_back(command_code::MoveWide(reg_number, constant & 0xFFFF));
+                if ((constant >> 16) != 0) {
+                    command_list.push_back(command_code::MoveTop(reg_number, constant >> 16));
+                }
+            }
+        }
+
+        constexpr uint32_t GetConstantSize(uint32_t constant) {
+            CommandCounter counter;
+            SetConstant(counter, 0, constant);
+            return counter.size();
+        }
+
+        // Always a movw/movt pair, so that linking can patch the address
+        template <class CommandList>
+        constexpr void SetAddress(CommandList& command_list, uint32_t reg_number, uint32_t address) {
+            uint32_t upper_part = (address >> 16),
+                     lower_part = (address & ((1 << 16) - 1));
+            upper_part = AdaptConstantToWrite(upper_part);
+            lower_part = AdaptConstantToWrite(lower_part);
+            command_list.push_back(command_code::MOVW[reg_number] | lower_part);
+            command_list.push_back(command_code::MOVT[reg_number] | upper_part);
+        }
+
+        // Rewrites the constant of movw/movt pair written by SetAddress
+        constexpr void PatchConstant(uint32_t* commands, uint32_t constant) {
+            constexpr uint32_t IMMEDIATE_MASK = AdaptConstantToWrite(0xFFFF);
+            commands[0] = (commands[0] & ~IMMEDIATE_MASK) | AdaptConstantToWrite(constant & 0xFFFF);
+            commands[1] = (commands[1] & ~IMMEDIATE_MASK) | AdaptConstantToWrite(constant >> 16);
+        }
+
+        template <class CommandList>
+        constexpr void LoadVariable(CommandList& command_list, uint32_t reg_number, uint32_t var_address) {
+            SetAddress(command_list, reg_number, var_address);
+            command_list.push_back(command_code::LDR[reg_number]);
+        }
+
+        template <class CommandList>
+        void LoadVariable(CommandList& command_list, uint32_t reg_number, void* var_pointer) {
+            LoadVariable(command_list, reg_number, reinterpret_cast<uint32_t>(var_pointer));
+        }
+
+        template <class CommandList>
+        constexpr void CallFunction(CommandList& command_list, uint32_t func_address) {
+            SetAddress(command_list, 4, func_address);
+            command_list.push_back(command_code::BLX_R4);
+        }
+
+        template <class CommandList>
+        void CallFunction(CommandList& command_list, void* func_pointer) {
+            CallFunction(command_list, reinterpret_cast<uint32_t>(func_pointer));
+        }
+
+        // Moves arguments from the stack to r0-r3
+        template <class CommandList>
+        constexpr void SetArguments(CommandList& command_list, uint32_t num_arguments) {
+            for (uint32_t i = num_arguments; i > 0; --i) {
+                command_list.push_back(command_code::POP[i - 1]);
+            }
+            // Set other arguments to zero - to call sum(a, b)
+            for (uint32_t i = num_arguments; i < 4; ++i) {
+                SetConstant(command_list, i, 0);
+            }
+        }
+
+        template <class CommandList>
+        void CallFunction(CommandList& command_list, void* func_pointer,
+                          uint32_t num_arguments) {
+            SetArguments(command_list, num_arguments);
+            CallFunction(command_list, func_pointer);
+            // Save result
+            command_list.push_back(command_code::PUSH_R0);
+        }
+
+        template <class CommandList>
+        constexpr void CompleteBinaryOperation(CommandList& command_list, parser::Operation operation) {
+            command_list.push_back(command_code::POP[1]);
+            command_list.push_back(command_code::POP[0]);
+            switch (operation) {
+            case parser::Operation::PLUS:
+                command_list.push_back(command_code::ADD_R0_R0_R1);
+                break;
+
+            case parser::Operation::MINUS:
+                command_list.push_back(command_code::SUB_R0_R0_R1);;
+                break;
+
+            case parser::Operation::MULTIPLY:
+                command_list.push_back(command_code::MUL_R0_R0_R1);;
+                break;
+
+            default:
+                break;
+            }
+            // save result
+            command_list.push_back(command_code::PUSH_R0);
+        }
+
+        // Removes a constant set and pushed by the last commands
+        template <class CommandList>
+        constexpr void RemoveConstantOnTop(CommandList& command_list, uint32_t constant) {
+            for (uint32_t i = 0; i <= GetConstantSize(constant); ++i) {
+                command_list.pop_back();
+            }
+        }
+
+        // Same as CompleteBinaryOperation when the right operand is the constant on top:
+        // it is not pushed, and add and sub take it as an immediate if it fits
+        template <class CommandList>
+        constexpr void CompleteBinaryOperationWithConstant(CommandList& command_list,
+                                                           parser::Operation operation, uint32_t right) {
+            RemoveConstantOnTop(command_list, right);
+            command_list.push_back(command_code::POP[0]);
+            uint32_t immediate = 0;
+            if (operation != parser::Operation::MULTIPLY && command_code::EncodeImmediate(right, immediate)) {
+                command_list.push_back(command_code::DataImmediate(
+                    operation == parser::Operation::PLUS ? command_code::ADD : command_code::SUB, 0, 0, immediate));
+            } else if (operation != parser::Operation::MULTIPLY &&
+                       command_code::EncodeImmediate(0u - right, immediate)) {
+                command_list.push_back(command_code::DataImmediate(
+                    operation == parser::Operation::PLUS ? command_code::SUB : command_code::ADD, 0, 0, immediate));
+            } else {
+                SetConstant(command_list, 1, right);
+                command_list.push_back(operation == parser::Operation::PLUS ? command_code::ADD_R0_R0_R1 :
+                                       operation == parser::Operation::MINUS ? command_code::SUB_R0_R0_R1 :
+                                                                               command_code::MUL_R0_R0_R1);
+            }
+            command_list.push_back(command_code::PUSH_R0);
+        }
+
+        template <class CommandList>
+        constexpr void CompleteUnaryMinus(CommandList& command_list) {
+            command_list.push_back(command_code::POP[0]);
+            command_list.push_back(command_code::DataImmediate(command_code::RSB, 0, 0, 0));
+            command_list.push_back(command_code::PUSH_R0);
+        }
+
+        // Wraps around exactly like ADD, SUB and MUL
+        constexpr uint32_t FoldBinaryOperation(parser::Operation operation,
+                                               uint32_t left, uint32_t right) {
+            switch (operation) {
+            case parser::Operation::PLUS:
+                return left + right;
+
+            case parser::Operation::MINUS:
+                return left - right;
+
+            case parser::Operation::MULTIPLY:
+                return left * right;
+
+            default:
+                return 0;
+            }
+        }
+
+        // Replaces constants set and pushed by the last commands with a single one
+        template <class CommandList>
+        constexpr void ReplaceConstantsOnTop(CommandList& command_list,
+                                             std::initializer_list<uint32_t> constants,
+                                             uint32_t constant) {
+            for (uint32_t replaced : constants) {
+                RemoveConstantOnTop(command_list, replaced);
+            }
+            SetConstant(command_list, 0, constant);
+            command_list.push_back(command_code::PUSH_R0);
+        }
+
+        template <class CommandList>
+        constexpr void BeginFunction(CommandList& command_list) {
+            command_list.push_back(command_code::PUSH_R4_LR);
+        }
+
+        template <class CommandList>
+        constexpr void EndFunction(CommandList& command_list) {
+            // Last command should be push {r0}, so just remove it
+            command_list.pop_back();
+            command_list.push_back(command_code::POP_R4_LR);
+            command_list.push_back(command_code::BX_LR);
+        }
+    } // namespace translator
+} // namespace JIT
+
+#endif // COMMANDS_H_
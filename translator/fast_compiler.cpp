@@ -0,0 +1,133 @@
+#include "translator/fast_compiler.h"
+
+#include "translator/precedence_compiler.h"
+
+#include <iostream>
+#include <string>
+
+namespace JIT {
+    namespace translator {
+        void ThrowUndefinedSymbol(std::string_view name) {
+            throw std::out_of_range("Undefined symbol " + std::string(name));
+        }
+
+        // Symbol lookup by scanning externs, fine for a handful of symbols
+        class ExternsList {
+        public:
+            explicit ExternsList(const symbol_t* externs) : externs_(externs) {
+            }
+
+            uint32_t Find(std::string_view name, uint32_t) const {
+                void* pointer = FindSymbol(externs_, name);
+                if (pointer == nullptr) {
+                    ThrowUndefinedSymbol(name);
+                }
+                return reinterpret_cast<uint32_t>(pointer);
+            }
+
+        private:
+            const symbol_t* externs_;
+        };
+
+        // Open addressing hash table of externs placed in an arena
+        class SymbolTable {
+        public:
+            SymbolTable(const symbol_t* externs, Arena& arena) {
+                uint32_t num_symbols = 0;
+                while (externs[num_symbols].name != nullptr &&
+                       externs[num_symbols].pointer != nullptr) {
+                    ++num_symbols;
+                }
+                // Keep load factor at most 1/2
+                while (capacity_ < 2 * num_symbols) {
+                    capacity_ *= 2;
+                }
+                slots_ = arena.Allocate<const symbol_t*>(capacity_);
+                for (uint32_t i = 0; i < capacity_; ++i) {
+                    slots_[i] = nullptr;
+                }
+                for (uint32_t i = 0; i < num_symbols; ++i) {
+                    // The last of equal names stays, as with FindSymbol
+                    *FindSlot(externs[i].name) = &externs[i];
+                }
+            }
+
+            uint32_t Find(std::string_view name, uint32_t) const {
+                const symbol_t* symbol = *FindSlot(name);
+                if (symbol == nullptr) {
+                    ThrowUndefinedSymbol(name);
+                }
+                return reinterpret_cast<uint32_t>(symbol->pointer);
+            }
+
+        private:
+            static uint32_t Hash(std::string_view name) {
+                // FNV-1a
+                uint32_t hash = 2166136261u;
+                for (char symbol : name) {
+                    hash = (hash ^ static_cast<uint8_t>(symbol)) * 16777619u;
+                }
+                return hash;
+            }
+
+            const symbol_t** FindSlot(std::string_view name) const {
+                uint32_t slot = Hash(name) & (capacity_ - 1);
+                while (slots_[slot] != nullptr && name != slots_[slot]->name) {
+                    slot = (slot + 1) & (capacity_ - 1);
+                }
+                return &slots_[slot];
+            }
+
+            uint32_t capacity_ = 1;
+            const symbol_t** slots_;
+        };
+
+        uint32_t CompileExpressionFast(std::string_view expression,
+                                       const symbol_t* externs,
+                                       uint32_t* out) {
+            ExternsList symbols(externs);
+            return PrecedenceCompiler<ExternsList, CommandWriter>(
+                expression, symbols, CommandWriter(out)).Compile();
+        }
+
+        uint32_t CompileExpressionFast(std::string_view expression,
+                                       const symbol_t* externs,
+                                       uint32_t* out,
+                                       Arena& arena) {
+            SymbolTable symbols(externs, arena);
+            return PrecedenceCompiler<SymbolTable, CommandWriter>(
+                expression, symbols, CommandWriter(out)).Compile();
+        }
+    } // namespace translator
+} // namespace JIT
+
+extern "C" int
+jit_compile_expression_to_arm_fast(const char * expression,
+                                   const symbol_t * externs,
+                                   void * out_buffer) {
+    try {
+        JIT::translator::CompileExpressionFast(expression, externs,
+                                               static_cast<uint32_t*>(out_buffer));
+        return 1;
+    } catch (std::exception& error) {
+        std::cout << "Parser error: " << error.what() << std::endl;
+        return 0;
+    }
+}
+
+extern "C" int
+jit_compile_expression_to_arm_in_arena(const char * expression,
+                                       const symbol_t * externs,
+                                       void * out_buffer,
+                                       void * scratch,
+                                       size_t scratch_size) {
+    try {
+        JIT::translator::Arena arena(scratch, scratch_size);
+        JIT::translator::CompileExpressionFast(expression, externs,
+                                               static_cast<uint32_t*>(out_buffer), arena);
+        return 1;
+    } catch (std::exception& error) {
+        std::cout << "Parser error: " << error.what() << std::endl;
+        return 0;
+    }
+}
@@ -0,0 +1,41 @@
+#ifndef FAST_COMPILER_H_
+#define FAST_COMPILER_H_
+
+#include <string_view>
+
+#include "translator/arena.h"
+#include "translator/translator.h"
+
+namespace JIT {
+    namespace translator {
+        // Single pass compiler for short one-shot expressions: parses by precedence
+        // climbing and emits the same code as GetARMCommandList while reducing,
+        // straight into out. Returns the number of written commands
+        uint32_t CompileExpressionFast(std::string_view expression,
+                                       const symbol_t* externs,
+                                       uint32_t* out);
+
+        // Same, but doesn't allocate heap memory on success: externs are indexed
+        // in a hash table placed in the arena
+        uint32_t CompileExpressionFast(std::string_view expression,
+                                       const symbol_t* externs,
+                                       uint32_t* out,
+                                       Arena& arena);
+    } // namespace translator
+} // namespace JIT
+
+extern "C" int
+jit_compile_expression_to_arm_fast(const char * expression,
+                                   const symbol_t * externs,
+                                   void * out_buffer);
+
+// Allocation-free compilation for latency sensitive threads: scratch memory
+// comes from the caller
+extern "C" int
+jit_compile_expression_to_arm_in_arena(const char * expression,
+                                       const symbol_t * externs,
+                                       void * out_buffer,
+                                       void * scratch,
+                                       size_t scratch_size);
+
+#endif // FAST_COMPILER_H_
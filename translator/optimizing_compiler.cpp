@@ -0,0 +1,125 @@
+#include "translator/optimizing_compiler.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include "translator/code_generator.h"
+#include "translator/peephole.h"
+
+namespace JIT {
+    namespace translator {
+        // Appends time since start to timings (if any) and restarts
+        void RecordTime(const char* name, std::chrono::steady_clock::time_point& start,
+                        std::vector<optimizer::PassTiming>* timings) {
+            auto now = std::chrono::steady_clock::now();
+            if (timings != nullptr) {
+                std::chrono::nanoseconds elapsed = now - start;
+                timings->push_back({name, static_cast<uint64_t>(elapsed.count())});
+            }
+            start = now;
+        }
+
+        // Stack machine code of O0 goes through the peephole optimizer. The code
+        // generator emits none of its patterns, and its bl offsets must stay
+        void OptimizeCode(const CompileOptions& options, std::vector<uint32_t>& command_list) {
+            uint32_t num_removed = OptimizePeephole(command_list);
+            if (options.num_removed_commands != nullptr) {
+                *options.num_removed_commands = num_removed;
+            }
+        }
+
+        parser::Error CompileExpression(std::string_view expression,
+                                        const symbol_t* externs,
+                                        const CompileOptions& options,
+                                        std::vector<uint32_t>& command_list) {
+            auto start = std::chrono::steady_clock::now();
+            std::vector<parser::Token> splitted_expr, postfix_notation;
+            parser::Error error = parser::SplitToTokens(expression, splitted_expr);
+            if (!error) {
+                error = parser::ConvertToPostfixNotation(expression, splitted_expr, postfix_notation);
+            }
+            if (error) {
+                return error;
+            }
+            std::unordered_map<std::string_view, void*> externs_map;
+            for (auto symbol = externs; symbol->name != nullptr && symbol->pointer != nullptr; ++symbol) {
+                externs_map[symbol->name] = symbol->pointer;
+            }
+            RecordTime("parse", start, options.timings);
+
+            if (options.optimizer.level == optimizer::OptimizationLevel::O0) {
+                error = GetARMCommandList(expression, postfix_notation, externs_map, command_list);
+                if (!error) {
+                    OptimizeCode(options, command_list);
+                }
+                RecordTime("codegen", start, options.timings);
+                return error;
+            }
+
+            std::unordered_map<std::string_view, optimizer::SymbolInfo> symbol_infos;
+            for (auto info = options.symbol_infos; info != nullptr && info->name != nullptr; ++info) {
+                symbol_infos[info->name] = {info->arity,
+                                            static_cast<optimizer::Purity>(std::clamp(info->purity, 0, 2)),
+                                            info->cost};
+            }
+            optimizer::Function function;
+            error = optimizer::BuildFunction(expression, postfix_notation, externs_map, function,
+                                             symbol_infos);
+            if (error) {
+                return error;
+            }
+            RecordTime("build", start, options.timings);
+            optimizer::CreatePassManager(options.optimizer).Run(function, options.timings);
+            start = std::chrono::steady_clock::now();
+            GenerateCode(function, options.code_address, command_list);
+            if (options.num_removed_commands != nullptr) {
+                *options.num_removed_commands = 0;
+            }
+            RecordTime("codegen", start, options.timings);
+            return {};
+        }
+    } // namespace translator
+} // namespace JIT
+
+extern "C" int
+jit_compile_expression_to_arm_with_options(const char * expression,
+                                           const symbol_t * externs,
+                                           void * out_buffer,
+                                           jit_options_t * options,
+                                           jit_error_t * error) {
+    JIT::translator::CompileOptions compile_options;
+    std::vector<JIT::optimizer::PassTiming> timings;
+    compile_options.code_address = reinterpret_cast<uint32_t>(out_buffer);
+    if (options != nullptr) {
+        compile_options.optimizer.level = static_cast<JIT::optimizer::OptimizationLevel>(
+            std::clamp(options->optimization_level, 0, 3));
+        compile_options.optimizer.calls_modify_variables = !options->calls_preserve_variables;
+        compile_options.symbol_infos = options->symbol_infos;
+        compile_options.num_removed_commands = &options->num_removed_commands;
+        if (options->saturation_budget != 0) {
+            compile_options.optimizer.saturation_budget = options->saturation_budget;
+        }
+        if (options->timings != nullptr) {
+            compile_options.timings = &timings;
+        }
+    }
+
+    std::vector<uint32_t> command_list;
+    JIT::parser::Error result = JIT::translator::CompileExpression(expression, externs, compile_options,
+                                                                   command_list);
+    if (options != nullptr && options->timings != nullptr) {
+        options->num_timings = std::min<uint32_t>(timings.size(), options->max_timings);
+        for (uint32_t i = 0; i < options->num_timings; ++i) {
+            options->timings[i] = {timings[i].name, timings[i].nanoseconds};
+        }
+    }
+    if (error != nullptr) {
+        error->kind = static_cast<int>(result.kind);
+        error->position = result.position;
+    }
+    if (result) {
+        return 0;
+    }
+    std::copy(command_list.begin(), command_list.end(), static_cast<uint32_t*>(out_buffer));
+    return 1;
+}
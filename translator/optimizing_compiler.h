@@ -0,0 +1,60 @@
+#ifndef OPTIMIZING_COMPILER_H_
+#define OPTIMIZING_COMPILER_H_
+
+#include <string_view>
+#include <vector>
+
+#include "optimizer/pass_manager.h"
+#include "translator/translator.h"
+
+namespace JIT {
+    namespace translator {
+        struct CompileOptions {
+            optimizer::OptimizerOptions optimizer;
+            // Time of parsing, of every pass and of code generation is appended if set
+            std::vector<optimizer::PassTiming>* timings = nullptr;
+            // Descriptors of extern functions terminated by a null name, may be null
+            const symbol_info_t* symbol_infos = nullptr;
+            // Number of commands removed by the peephole optimizer (at O0 only, zero
+            // otherwise) is stored if set
+            uint32_t* num_removed_commands = nullptr;
+            // Address the code is going to run at, enables direct calls if nonzero
+            uint32_t code_address = 0;
+        };
+
+        // At O0 the code is the one of GetARMCommandList after the peephole optimizer,
+        // other levels compile through the optimizer
+        parser::Error CompileExpression(std::string_view expression,
+                                        const symbol_t* externs,
+                                        const CompileOptions& options,
+                                        std::vector<uint32_t>& command_list);
+    } // namespace translator
+} // namespace JIT
+
+typedef struct {
+    const char *name;
+    uint64_t nanoseconds;
+} jit_pass_timing_t;
+
+typedef struct {
+    int optimization_level;       // 0 for the fastest compilation, 2 for good code, 3 for the best code
+    jit_pass_timing_t *timings;   // Filled if not NULL
+    uint32_t max_timings;         // Size of timings
+    uint32_t num_timings;         // Set by the compilation
+    int calls_preserve_variables; // Nonzero if externs never change variables
+    const symbol_info_t *symbol_infos; // Terminated by a NULL name, may be NULL
+    uint32_t saturation_budget;   // E-graph nodes at level 3, 0 for the default
+    uint32_t num_removed_commands; // Set by the compilation: removed by the peephole optimizer at level 0
+} jit_options_t;
+
+// Same as jit_compile_expression_to_arm_checked with options (default ones if NULL).
+// At levels above 0 externs may be called by bl relative to out_buffer, so the
+// code must run right there: copied elsewhere it calls wrong addresses
+extern "C" int
+jit_compile_expression_to_arm_with_options(const char * expression,
+                                           const symbol_t * externs,
+                                           void * out_buffer,
+                                           jit_options_t * options,
+                                           jit_error_t * error);
+
+#endif // OPTIMIZING_COMPILER_H_
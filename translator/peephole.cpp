@@ -0,0 +1,57 @@
+#include "translator/peephole.h"
+
+#include "translator/commands.h"
+
+namespace JIT {
+    namespace translator {
+        // Replaces the last kept command and the next one with equal commands,
+        // returns false if they don't match any pattern
+        bool Rewrite(uint32_t last, uint32_t next, std::vector<uint32_t>& replacement) {
+            // push {r0}; pop {r0}
+            if (last == command_code::PUSH_R0 && next == command_code::POP[0]) {
+                replacement.clear();
+                return true;
+            }
+            // push {r0}; pop {ri} = mov ri, r0
+            for (uint32_t reg = 1; reg < 4; ++reg) {
+                if (last == command_code::PUSH_R0 && next == command_code::POP[reg]) {
+                    replacement = {command_code::DataRegister(command_code::MOV, reg, 0, 0)};
+                    return true;
+                }
+            }
+            // movw ri, #0; movt ri, #0 = mov ri, #0
+            for (uint32_t reg = 0; reg < command_code::SP; ++reg) {
+                if (last == command_code::MoveWide(reg, 0) && next == command_code::MoveTop(reg, 0)) {
+                    replacement = {command_code::DataImmediate(command_code::MOV, reg, 0, 0)};
+                    return true;
+                }
+            }
+            // pop {..., lr}; bx lr = pop {..., pc}
+            if ((last & 0xFFFF0000) == command_code::Pop(0) && (last >> command_code::LR) % 2 != 0 &&
+                next == command_code::BX_LR) {
+                replacement = {last ^ (1u << command_code::LR) ^ (1u << command_code::PC)};
+                return true;
+            }
+            return false;
+        }
+
+        uint32_t OptimizePeephole(std::vector<uint32_t>& command_list) {
+            uint32_t size = 0;
+            std::vector<uint32_t> replacement;
+            for (uint32_t command : command_list) {
+                // Removed pairs expose earlier commands to the next ones
+                if (size == 0 || !Rewrite(command_list[size - 1], command, replacement)) {
+                    command_list[size++] = command;
+                    continue;
+                }
+                --size;
+                for (uint32_t rewritten : replacement) {
+                    command_list[size++] = rewritten;
+                }
+            }
+            uint32_t num_removed = command_list.size() - size;
+            command_list.resize(size);
+            return num_removed;
+        }
+    } // namespace translator
+} // namespace JIT
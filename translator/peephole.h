@@ -0,0 +1,17 @@
+#ifndef PEEPHOLE_H_
+#define PEEPHOLE_H_
+
+#include <cstdint>
+#include <vector>
+
+namespace JIT {
+    namespace translator {
+        // Rewrites redundant sequences of straight-line code: push {r0} followed by
+        // a pop, zero set by movw and movt, and return by pop and bx lr. Commands
+        // move, so the code must have no relocations left to patch and no relative
+        // branches. Returns the number of removed commands
+        uint32_t OptimizePeephole(std::vector<uint32_t>& command_list);
+    } // namespace translator
+} // namespace JIT
+
+#endif // PEEPHOLE_H_
@@ -0,0 +1,197 @@
+#ifndef PRECEDENCE_COMPILER_H_
+#define PRECEDENCE_COMPILER_H_
+
+#include <string_view>
+
+#include "parser/classifier.h"
+#include "parser/parser.h"
+#include "translator/commands.h"
+
+namespace JIT {
+    namespace translator {
+        // Single pass compiler: parses by precedence climbing and emits the same code
+        // as GetARMCommandList while reducing. Symbols::Find(name, command_index) gives
+        // the address of a symbol set by movw/movt at command_index. Usable at compile
+        // time, where errors stop the build
+        template <class Symbols, class CommandList>
+        class PrecedenceCompiler {
+        public:
+            constexpr PrecedenceCompiler(std::string_view input, Symbols& symbols,
+                                         CommandList command_list)
+                : input_(input), symbols_(symbols), command_list_(command_list) {
+            }
+
+            // Returns the number of commands
+            constexpr uint32_t Compile() {
+                BeginFunction(command_list_);
+                ParseExpression(GetPriority(parser::Operation::PLUS));
+                switch (Peek()) {
+                case 0:
+                    break;
+
+                case ')':
+                    throw parser::missing_open_bracket();
+
+                default:
+                    throw parser::missing_operator();
+                }
+                EndFunction(command_list_);
+                return command_list_.size();
+            }
+
+        private:
+            // Same as in shunting-yard conversion
+            static constexpr uint32_t GetPriority(parser::Operation operation) {
+                return operation == parser::Operation::MULTIPLY ? 3 : 2;
+            }
+
+            static constexpr bool IsClass(char symbol, uint8_t classes) {
+                return (parser::GetCharClass(symbol) & classes) != 0;
+            }
+
+            // Next significant symbol or 0 at the end of input
+            constexpr char Peek() {
+                while (pos_ < input_.size() && IsClass(input_[pos_], parser::CLASS_SPACE)) {
+                    ++pos_;
+                }
+                return pos_ < input_.size() ? input_[pos_] : 0;
+            }
+
+            constexpr std::string_view ReadWhile(uint8_t classes) {
+                uint32_t begin = pos_;
+                while (pos_ < input_.size() && IsClass(input_[pos_], classes)) {
+                    ++pos_;
+                }
+                return input_.substr(begin, pos_ - begin);
+            }
+
+            constexpr void ParseExpression(uint32_t min_priority) {
+                ParseOperand();
+                while (true) {
+                    char symbol = Peek();
+                    if (symbol == 0 || symbol == ')' || symbol == ',') {
+                        return;
+                    }
+                    if (symbol != '+' && symbol != '-' && symbol != '*') {
+                        if (IsClass(symbol, parser::CLASS_ALPHA | parser::CLASS_DIGIT) ||
+                            symbol == '(') {
+                            throw parser::missing_operator();
+                        }
+                        throw parser::unknown_symbol(symbol);
+                    }
+                    auto operation = static_cast<parser::Operation>(symbol);
+                    uint32_t priority = GetPriority(operation);
+                    if (priority < min_priority) {
+                        return;
+                    }
+                    ++pos_;
+                    bool is_left_constant = is_constant_on_top_;
+                    uint32_t left = constant_on_top_;
+                    // Binary operations are left associative
+                    ParseExpression(priority + 1);
+                    if (is_left_constant && is_constant_on_top_) {
+                        uint32_t right = constant_on_top_;
+                        constant_on_top_ = FoldBinaryOperation(operation, left, right);
+                        ReplaceConstantsOnTop(command_list_, {left, right}, constant_on_top_);
+                    } else if (is_constant_on_top_) {
+                        CompleteBinaryOperationWithConstant(command_list_, operation, constant_on_top_);
+                        is_constant_on_top_ = false;
+                    } else {
+                        CompleteBinaryOperation(command_list_, operation);
+                        is_constant_on_top_ = false;
+                    }
+                }
+            }
+
+            constexpr void ParseOperand() {
+                char symbol = Peek();
+                if (IsClass(symbol, parser::CLASS_DIGIT)) {
+                    // Literals wrap around like the 32-bit arithmetic they are used in
+                    uint32_t number = 0;
+                    for (char digit : ReadWhile(parser::CLASS_DIGIT)) {
+                        number = number * 10 + (digit - '0');
+                    }
+                    SetConstant(command_list_, 0, number);
+                    command_list_.push_back(command_code::PUSH_R0);
+                    is_constant_on_top_ = true;
+                    constant_on_top_ = number;
+                } else if (IsClass(symbol, parser::CLASS_ALPHA)) {
+                    std::string_view name = ReadWhile(parser::CLASS_ALPHA | parser::CLASS_DIGIT);
+                    if (pos_ < input_.size() && input_[pos_] == '(') {
+                        ++pos_;
+                        ParseCall(name);
+                    } else {
+                        LoadVariable(command_list_, 0, symbols_.Find(name, command_list_.size()));
+                        command_list_.push_back(command_code::PUSH_R0);
+                    }
+                    is_constant_on_top_ = false;
+                } else if (symbol == '(') {
+                    ++pos_;
+                    ParseExpression(GetPriority(parser::Operation::PLUS));
+                    ExpectCloseBracket();
+                } else if (symbol == '-') {
+                    // Unary minus binds tighter than any binary operation
+                    ++pos_;
+                    ParseOperand();
+                    if (is_constant_on_top_) {
+                        uint32_t constant = constant_on_top_;
+                        constant_on_top_ = 0u - constant;
+                        ReplaceConstantsOnTop(command_list_, {constant}, constant_on_top_);
+                    } else {
+                        CompleteUnaryMinus(command_list_);
+                    }
+                } else if (symbol == 0 || symbol == '+' || symbol == '*' ||
+                           symbol == ')' || symbol == ',') {
+                    throw parser::missing_operand();
+                } else {
+                    throw parser::unknown_symbol(symbol);
+                }
+            }
+
+            constexpr void ParseCall(std::string_view name) {
+                uint32_t num_arguments = 0;
+                if (Peek() == ')') {
+                    ++pos_;
+                } else {
+                    while (true) {
+                        ParseExpression(GetPriority(parser::Operation::PLUS));
+                        ++num_arguments;
+                        if (Peek() != ',') {
+                            break;
+                        }
+                        ++pos_;
+                    }
+                    ExpectCloseBracket();
+                }
+                SetArguments(command_list_, num_arguments);
+                CallFunction(command_list_, symbols_.Find(name, command_list_.size()));
+                command_list_.push_back(command_code::PUSH_R0);
+            }
+
+            constexpr void ExpectCloseBracket() {
+                switch (Peek()) {
+                case ')':
+                    ++pos_;
+                    break;
+
+                case 0:
+                    throw parser::missing_close_bracket();
+
+                default:
+                    throw parser::missing_operator();
+                }
+            }
+
+            std::string_view input_;
+            uint32_t pos_ = 0;
+            // Whether the value on top of the stack is known at compile time, so that
+            // operations on constants are folded
+            bool is_constant_on_top_ = false;
+            uint32_t constant_on_top_ = 0;
+            Symbols& symbols_;
+            CommandList command_list_;
+        };
+    } // namespace translator
+} // namespace JIT
+
+#endif // PRECEDENCE_COMPILER_H_
@@ -0,0 +1,21 @@
+#include "translator/static_compiler.h"
+
+#include <algorithm>
+#include <string>
+
+namespace JIT {
+    namespace translator {
+        void Link(const uint32_t* commands, uint32_t num_commands,
+                  const Relocation* relocations, uint32_t num_relocations,
+                  const symbol_t* externs, uint32_t* out) {
+            std::copy(commands, commands + num_commands, out);
+            for (uint32_t i = 0; i < num_relocations; ++i) {
+                void* pointer = FindSymbol(externs, relocations[i].name);
+                if (pointer == nullptr) {
+                    throw std::out_of_range("Undefined symbol " + std::string(relocations[i].name));
+                }
+                PatchConstant(out + relocations[i].command_index, reinterpret_cast<uint32_t>(pointer));
+            }
+        }
+    } // namespace translator
+} // namespace JIT
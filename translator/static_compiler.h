@@ -0,0 +1,91 @@
+#ifndef STATIC_COMPILER_H_
+#define STATIC_COMPILER_H_
+
+#include <array>
+#include <string_view>
+
+#include "translator/precedence_compiler.h"
+#include "translator/translator.h"
+
+namespace JIT {
+    namespace translator {
+        // Symbol address set by movw/movt pair at command_index, filled in by Link
+        struct Relocation {
+            uint32_t command_index = 0;
+            std::string_view name;
+        };
+
+        template <uint32_t NUM_COMMANDS, uint32_t NUM_RELOCATIONS>
+        struct StaticCode {
+            std::array<uint32_t, NUM_COMMANDS> commands{};
+            std::array<Relocation, NUM_RELOCATIONS> relocations{};
+        };
+
+        // Symbols of compile time compilation: addresses are zero until linking
+        template <uint32_t CAPACITY>
+        class RelocationRecorder {
+        public:
+            constexpr uint32_t Find(std::string_view name, uint32_t command_index) {
+                if (size_ < CAPACITY) {
+                    relocations_[size_] = {command_index, name};
+                }
+                ++size_;
+                return 0;
+            }
+
+            constexpr uint32_t Size() const {
+                return size_;
+            }
+
+            constexpr const std::array<Relocation, CAPACITY>& Relocations() const {
+                return relocations_;
+            }
+
+        private:
+            uint32_t size_ = 0;
+            std::array<Relocation, CAPACITY> relocations_{};
+        };
+
+        struct StaticCodeSize {
+            uint32_t num_commands;
+            uint32_t num_relocations;
+        };
+
+        constexpr StaticCodeSize GetStaticCodeSize(std::string_view expression) {
+            RelocationRecorder<0> symbols;
+            uint32_t num_commands = PrecedenceCompiler<RelocationRecorder<0>, CommandCounter>(
+                expression, symbols, CommandCounter()).Compile();
+            return {num_commands, symbols.Size()};
+        }
+
+        // Compiles an expression at build time, incorrect expressions stop the build:
+        //     static constexpr char expression[] = "a*b+3";
+        //     constexpr auto code = JIT::translator::Compile<expression>();
+        // The code is the same as of GetARMCommandList once linked
+        template <const char* EXPRESSION>
+        constexpr auto Compile() {
+            constexpr StaticCodeSize size = GetStaticCodeSize(EXPRESSION);
+            StaticCode<size.num_commands, size.num_relocations> code;
+            RelocationRecorder<size.num_relocations> symbols;
+            PrecedenceCompiler<RelocationRecorder<size.num_relocations>, CommandWriter>(
+                EXPRESSION, symbols, CommandWriter(code.commands.data())).Compile();
+            code.relocations = symbols.Relocations();
+            return code;
+        }
+
+        // Copies commands to out setting symbol addresses from externs.
+        // Throws std::out_of_range for undefined symbols
+        void Link(const uint32_t* commands, uint32_t num_commands,
+                  const Relocation* relocations, uint32_t num_relocations,
+                  const symbol_t* externs, uint32_t* out);
+
+        template <uint32_t NUM_COMMANDS, uint32_t NUM_RELOCATIONS>
+        void Link(const StaticCode<NUM_COMMANDS, NUM_RELOCATIONS>& code,
+                  const symbol_t* externs, uint32_t* out) {
+            Link(code.commands.data(), NUM_COMMANDS, code.relocations.data(), NUM_RELOCATIONS,
+                 externs, out);
+        }
+    } // namespace translator
+} // namespace JIT
+
+#endif // STATIC_COMPILER_H_
@@ -0,0 +1,165 @@
+#include "translator/strength_reduction.h"
+
+#include "optimizer/ir.h"
+
+namespace JIT {
+    namespace translator {
+        using optimizer::IsPowerOfTwo;
+        using Step = MultiplicationStep;
+
+        uint32_t Log2(uint32_t power_of_two) {
+            return __builtin_ctz(power_of_two);
+        }
+
+        // Inverse of an odd number modulo 2^32 by Newton's iteration, each one
+        // doubles the number of correct bits starting from 3
+        uint32_t Inverse(uint32_t odd) {
+            uint32_t inverse = odd;
+            for (uint32_t i = 0; i < 4; ++i) {
+                inverse *= 2 - odd * inverse;
+            }
+            return inverse;
+        }
+
+        // Single step computing multiplier * source from source only
+        bool FindStep(uint32_t multiplier, StepOperand source, Step& step) {
+            if (multiplier == 0xFFFFFFFF) {
+                step = {Step::NEGATE, source, source, 0};
+            } else if (IsPowerOfTwo(multiplier) && multiplier > 1) {
+                step = {Step::SHIFT, source, source, static_cast<uint8_t>(Log2(multiplier))};
+            } else if (IsPowerOfTwo(multiplier - 1) && multiplier > 2) {
+                step = {Step::ADD, source, source, static_cast<uint8_t>(Log2(multiplier - 1))};
+            } else if (IsPowerOfTwo(multiplier + 1) && multiplier > 1) {
+                step = {Step::RSB, source, source, static_cast<uint8_t>(Log2(multiplier + 1))};
+            } else if (IsPowerOfTwo(1 - multiplier) && multiplier != 0) {
+                step = {Step::SUB, source, source, static_cast<uint8_t>(Log2(1 - multiplier))};
+            } else {
+                return false;
+            }
+            return true;
+        }
+
+        // Values t such that t << shift == value modulo 2^32: top bits are free,
+        // both zero and sign extension are tried
+        template <class Check>
+        bool ForShiftedOut(uint32_t value, uint32_t shift, Check check) {
+            if (shift != 0 && (value & ((1u << shift) - 1)) != 0) {
+                return false;
+            }
+            uint32_t unsigned_part = value >> shift,
+                     signed_part = static_cast<uint32_t>(static_cast<int32_t>(value) >> shift);
+            return check(unsigned_part) || (signed_part != unsigned_part && check(signed_part));
+        }
+
+        // Two steps: t = FindStep(x), then a step over t or over t and x
+        bool FindTwoSteps(uint32_t multiplier, Step& first, Step& second) {
+            auto first_step = [&first](uint32_t t) {
+                return FindStep(t, StepOperand::X, first);
+            };
+            // multiplier = t * m where m is a single step over t
+            for (uint32_t shift = 1; shift < 32; ++shift) {
+                uint32_t power = 1u << shift;
+                if (ForShiftedOut(multiplier, shift, first_step)) {
+                    second = {Step::SHIFT, StepOperand::PREVIOUS, StepOperand::PREVIOUS,
+                              static_cast<uint8_t>(shift)};
+                    return true;
+                }
+                for (uint32_t factor : {power + 1, power - 1, 1 - power}) {
+                    if (factor != 1 && first_step(multiplier * Inverse(factor))) {
+                        FindStep(factor, StepOperand::PREVIOUS, second);
+                        return true;
+                    }
+                }
+            }
+            if (first_step(0u - multiplier)) {
+                second = {Step::NEGATE, StepOperand::PREVIOUS, StepOperand::PREVIOUS, 0};
+                return true;
+            }
+            // multiplier = t combined with x
+            for (uint32_t shift = 0; shift < 32; ++shift) {
+                uint8_t amount = static_cast<uint8_t>(shift);
+                uint32_t power = 1u << shift;
+                if (first_step(multiplier - power)) {
+                    second = {Step::ADD, StepOperand::PREVIOUS, StepOperand::X, amount};
+                } else if (first_step(multiplier + power)) {
+                    second = {Step::SUB, StepOperand::PREVIOUS, StepOperand::X, amount};
+                } else if (first_step(power - multiplier)) {
+                    second = {Step::RSB, StepOperand::PREVIOUS, StepOperand::X, amount};
+                } else if (ForShiftedOut(multiplier - 1, shift, first_step)) {
+                    second = {Step::ADD, StepOperand::X, StepOperand::PREVIOUS, amount};
+                } else if (ForShiftedOut(1 - multiplier, shift, first_step)) {
+                    second = {Step::SUB, StepOperand::X, StepOperand::PREVIOUS, amount};
+                } else if (ForShiftedOut(multiplier + 1, shift, first_step)) {
+                    second = {Step::RSB, StepOperand::X, StepOperand::PREVIOUS, amount};
+                } else {
+                    continue;
+                }
+                return true;
+            }
+            return false;
+        }
+
+        bool FindMultiplicationSequence(uint32_t multiplier, std::vector<MultiplicationStep>& sequence) {
+            sequence.clear();
+            if (multiplier == 1) {
+                return true;
+            }
+            Step first, second;
+            if (FindStep(multiplier, StepOperand::X, first)) {
+                sequence = {first};
+                return true;
+            }
+            if (FindTwoSteps(multiplier, first, second)) {
+                sequence = {first, second};
+                return true;
+            }
+            // Two steps, then a shift out of trailing zeros or a negation
+            Step last = {Step::NEGATE, StepOperand::PREVIOUS, StepOperand::PREVIOUS, 0};
+            uint32_t shift = multiplier != 0 ? Log2(multiplier & (0u - multiplier)) : 0;
+            if (shift != 0) {
+                last = {Step::SHIFT, StepOperand::PREVIOUS, StepOperand::PREVIOUS, static_cast<uint8_t>(shift)};
+                bool found = ForShiftedOut(multiplier, shift, [&](uint32_t t) {
+                    return FindTwoSteps(t, first, second);
+                });
+                if (found) {
+                    sequence = {first, second, last};
+                    return true;
+                }
+            } else if (FindTwoSteps(0u - multiplier, first, second)) {
+                sequence = {first, second, last};
+                return true;
+            }
+            return false;
+        }
+
+        uint32_t EvaluateMultiplicationSequence(const std::vector<MultiplicationStep>& sequence, uint32_t x) {
+            uint32_t previous = x;
+            for (const auto& step : sequence) {
+                uint32_t left = step.left == StepOperand::X ? x : previous,
+                         right = (step.right == StepOperand::X ? x : previous) << step.shift;
+                switch (step.kind) {
+                case Step::SHIFT:
+                    previous = left << step.shift;
+                    break;
+
+                case Step::ADD:
+                    previous = left + right;
+                    break;
+
+                case Step::SUB:
+                    previous = left - right;
+                    break;
+
+                case Step::RSB:
+                    previous = right - left;
+                    break;
+
+                default:
+                    previous = 0u - left;
+                    break;
+                }
+            }
+            return previous;
+        }
+    } // namespace translator
+} // namespace JIT
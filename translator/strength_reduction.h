@@ -0,0 +1,38 @@
+#ifndef STRENGTH_REDUCTION_H_
+#define STRENGTH_REDUCTION_H_
+
+#include <cstdint>
+#include <vector>
+
+namespace JIT {
+    namespace translator {
+        // Operand of a step: the multiplied value or the result of the previous step
+        enum struct StepOperand : uint8_t {
+            X,
+            PREVIOUS
+        };
+
+        // One data processing instruction with the barrel shifter
+        struct MultiplicationStep {
+            enum Kind : uint8_t {
+                SHIFT,    // left << shift
+                ADD,      // left + (right << shift)
+                SUB,      // left - (right << shift)
+                RSB,      // (right << shift) - left
+                NEGATE    // 0 - left
+            } kind;
+            StepOperand left;
+            StepOperand right;
+            uint8_t shift;
+        };
+
+        // Shortest sequence (up to 3 steps) computing x * multiplier modulo 2^32.
+        // Empty sequence means x itself. Returns false if there is none
+        bool FindMultiplicationSequence(uint32_t multiplier, std::vector<MultiplicationStep>& sequence);
+
+        // Value of the sequence for x, as computed by the instructions
+        uint32_t EvaluateMultiplicationSequence(const std::vector<MultiplicationStep>& sequence, uint32_t x);
+    } // namespace translator
+} // namespace JIT
+
+#endif // STRENGTH_REDUCTION_H_
@@ -9,7 +9,14 @@ namespace JIT {
     namespace translator {
         std::vector<uint32_t> GetARMCommandList(
             const std::vector<parser::Token>& postfix_notation_expression,
-            const std::unordered_map<std::string, void*>& external_symbols);
+            const std::unordered_map<std::string_view, void*>& external_symbols);
+
+        // Same without exceptions, postfix notation should be made from source
+        parser::Error GetARMCommandList(
+            std::string_view source,
+            const std::vector<parser::Token>& postfix_notation_expression,
+            const std::unordered_map<std::string_view, void*>& external_symbols,
+            std::vector<uint32_t>& command_list);
     } // namespace translator
 } // namespace JIT
 
@@ -19,9 +26,44 @@ typedef struct {
     void *pointer;
 } symbol_t;
 
+namespace JIT {
+    namespace translator {
+        // Pointer of the extern with the name, nullptr if there is none. Later
+        // symbols override earlier ones like in the default path
+        void* FindSymbol(const symbol_t* externs, std::string_view name);
+    } // namespace translator
+} // namespace JIT
+
+// Side effects of an extern function
+typedef enum {
+    JIT_IMPURE = 0, // May change variables or have other side effects
+    JIT_PURE = 1,   // Reads variables at most: equal calls between impure ones are merged
+    JIT_CONST = 2   // Depends on arguments only: calls on constants are made at compile time
+} jit_purity_t;
+
+// Extended descriptor of an extern function, for the optimizer
+typedef struct {
+    const char *name;
+    int arity;     // Number of arguments, -1 if unknown
+    int purity;    // jit_purity_t
+    uint32_t cost; // Approximate cycles per call, 0 if unknown
+} symbol_info_t;
+
+typedef struct {
+    int kind;          // JIT::parser::ErrorKind, 0 if there is no error
+    uint32_t position; // Byte offset in the expression
+} jit_error_t;
+
 extern "C" int
 jit_compile_expression_to_arm(const char * expression,
                               const symbol_t * externs,
                               void * out_buffer);
 
+// Doesn't throw or print anything, failure is described in error (if not NULL)
+extern "C" int
+jit_compile_expression_to_arm_checked(const char * expression,
+                                      const symbol_t * externs,
+                                      void * out_buffer,
+                                      jit_error_t * error);
+
 #endif // TRANSLATOR_H_
\ No newline at end of file